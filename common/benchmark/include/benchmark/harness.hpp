@@ -0,0 +1,103 @@
+#pragma once
+
+#include <benchmark/run.hpp>
+#include <benchmark/timer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Distribution of the time of one iteration, in nanoseconds
+struct SampleStats {
+    double mean = 0;
+    double stddev = 0;
+    double min = 0;
+    double median = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double max = 0;
+
+    // 95% confidence intervals: the normal approximation for the mean and
+    // order statistics for the median, which assume nothing about the shape
+    double mean_low = 0;
+    double mean_high = 0;
+    double median_low = 0;
+    double median_high = 0;
+};
+
+SampleStats ComputeStats(std::vector<double> samples);
+
+struct BenchmarkOptions {
+    // Iterations per sample are calibrated so that a sample takes this long
+    std::chrono::nanoseconds sample_time = std::chrono::milliseconds{10};
+    size_t samples = 30;
+    size_t warmup_samples = 2;
+    // Samples with wall time outside of [Q1 - k * IQR, Q3 + k * IQR] are
+    // dropped as outliers
+    double outlier_iqr = 3;
+};
+
+struct BenchmarkResult {
+    std::string name;
+    size_t iterations = 0;
+    size_t samples = 0;
+    size_t outliers = 0;
+    SampleStats wall;
+    SampleStats cpu;
+    // Mean hardware events per iteration, see CPUTimer::Events
+    std::array<std::optional<double>, CPUTimer::Events::kCount> events{};
+};
+
+BenchmarkResult Summarize(std::string name, size_t iterations,
+                          const std::vector<CPUTimer::Times>& samples,
+                          const BenchmarkOptions& options);
+
+// Calibrates the number of iterations of f per sample, then collects
+// options.samples samples of wall and CPU time
+template <class F>
+BenchmarkResult Measure(std::string name, F&& f,
+                        const BenchmarkOptions& options = {}) {
+    constexpr size_t kMaxGrowth = 10;
+
+    size_t iterations = 1;
+    while (true) {
+        const auto elapsed = RunWithWarmup(f, 0, iterations).wall_time;
+        if (elapsed >= options.sample_time) {
+            break;
+        }
+        // Aim slightly above the target, the first batches are noisy
+        size_t next = iterations * kMaxGrowth;
+        if (elapsed.count() > 0) {
+            const double scale = 1.2 * options.sample_time.count() /
+                                 static_cast<double>(elapsed.count());
+            next = std::min(next, static_cast<size_t>(iterations * scale));
+        }
+        iterations = std::max(next, iterations + 1);
+    }
+
+    for (size_t i = 0; i < options.warmup_samples; ++i) {
+        RunWithWarmup(f, 0, iterations);
+    }
+
+    std::vector<CPUTimer::Times> samples;
+    samples.reserve(options.samples);
+    for (size_t i = 0; i < options.samples; ++i) {
+        samples.push_back(RunWithWarmup(f, 0, iterations));
+    }
+    return Summarize(std::move(name), iterations, samples, options);
+}
+
+// One line with the median and its interval, p90, p99 and the CPU median
+void PrintResult(std::ostream& out, const BenchmarkResult& result);
+
+// A single JSON object without a trailing newline
+void WriteJson(std::ostream& out, const BenchmarkResult& result);
+
+// Appends the result as a line of JSON to the file named by BENCHMARK_JSON,
+// if it's set, so that runs of several benchmarks can be compared by a script
+void ReportJson(const BenchmarkResult& result);
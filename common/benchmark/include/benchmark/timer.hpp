@@ -1,6 +1,10 @@
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
 
 class CPUTimer {
   public:
@@ -11,10 +15,85 @@ class CPUTimer {
         Process,
     };
 
+    enum Counters {
+        // Hardware counters only if BENCHMARK_COUNTERS is set
+        DefaultCounters,
+        NoCounters,
+        HardwareCounters,
+    };
+
+    // Events counted in user space by perf_event_open. An event is empty if
+    // the kernel or the processor doesn't provide it (or forbids it, see
+    // /proc/sys/kernel/perf_event_paranoid): most VMs and containers don't.
+    struct Events {
+        enum Event {
+            Cycles,
+            Instructions,
+            CacheMisses,
+            BranchMisses,
+            DtlbMisses,
+        };
+        static constexpr size_t kCount = 5;
+        static constexpr const char* kNames[kCount] = {
+            "cycles", "instructions", "cache_misses", "branch_misses",
+            "dtlb_misses"};
+
+        // A raw perf reading: the count and the times the event was enabled
+        // and actually counted, which differ if it shared a counter
+        struct Reading {
+            uint64_t count;
+            uint64_t enabled;
+            uint64_t running;
+
+            Reading operator-(const Reading& other) const {
+                return {
+                    .count = count - other.count,
+                    .enabled = enabled - other.enabled,
+                    .running = running - other.running,
+                };
+            }
+        };
+
+        std::array<std::optional<Reading>, kCount> readings{};
+        // Readings scaled up to the whole time the event was enabled
+        std::array<std::optional<uint64_t>, kCount> counts{};
+
+        const std::optional<uint64_t>& operator[](Event event) const {
+            return counts[event];
+        }
+
+        static std::optional<uint64_t> Scale(const Reading& reading) {
+            if (reading.running == 0) {
+                return std::nullopt;
+            }
+            if (reading.running == reading.enabled) {
+                return reading.count;
+            }
+            return static_cast<uint64_t>(
+                static_cast<double>(reading.count) *
+                static_cast<double>(reading.enabled) /
+                static_cast<double>(reading.running));
+        }
+
+        // Raw readings are subtracted and only the difference is scaled:
+        // scaling both ends with different ratios could make it negative
+        Events operator-(const Events& other) const {
+            Events result;
+            for (size_t i = 0; i < kCount; ++i) {
+                if (readings[i] && other.readings[i]) {
+                    result.readings[i] = *readings[i] - *other.readings[i];
+                    result.counts[i] = Scale(*result.readings[i]);
+                }
+            }
+            return result;
+        }
+    };
+
     struct Times {
         WallClock::duration wall_time;
         std::chrono::microseconds cpu_utime;
         std::chrono::microseconds cpu_stime;
+        Events events;
 
         std::chrono::microseconds TotalCpuTime() const {
             return cpu_utime + cpu_stime;
@@ -25,15 +104,24 @@ class CPUTimer {
                 .wall_time = wall_time - other.wall_time,
                 .cpu_utime = cpu_utime - other.cpu_utime,
                 .cpu_stime = cpu_stime - other.cpu_stime,
+                .events = events - other.events,
             };
         }
     };
 
-    explicit CPUTimer(Type type = Type::Process);
+    explicit CPUTimer(Type type = Type::Process,
+                      Counters counters = Counters::DefaultCounters);
+
+    CPUTimer(const CPUTimer&) = delete;
+    CPUTimer& operator=(const CPUTimer&) = delete;
+
+    ~CPUTimer();
 
     Times GetTimes() const;
 
   private:
     const Type type_;
+    // perf_event_open descriptors, -1 for unavailable events
+    std::array<int, Events::kCount> perf_fds_;
     const Times start_;
 };
@@ -0,0 +1,204 @@
+#include <benchmark/harness.hpp>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// Two-sided 95%
+constexpr double kZ = 1.96;
+
+// Linear interpolation between the closest ranks of sorted samples
+double Percentile(const std::vector<double>& sorted, double p) {
+    const double position = p * static_cast<double>(sorted.size() - 1);
+    const auto lower = static_cast<size_t>(position);
+    if (lower + 1 >= sorted.size()) {
+        return sorted.back();
+    }
+    const double fraction = position - static_cast<double>(lower);
+    return sorted[lower] + fraction * (sorted[lower + 1] - sorted[lower]);
+}
+
+double Nanos(std::chrono::nanoseconds duration) {
+    return static_cast<double>(duration.count());
+}
+
+void WriteJsonString(std::ostream& out, const std::string& str) {
+    out << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+void WriteJson(std::ostream& out, const SampleStats& stats) {
+    out << "{\"mean\":" << stats.mean << ",\"stddev\":" << stats.stddev
+        << ",\"min\":" << stats.min << ",\"median\":" << stats.median
+        << ",\"p90\":" << stats.p90 << ",\"p99\":" << stats.p99
+        << ",\"max\":" << stats.max << ",\"mean_ci\":[" << stats.mean_low
+        << "," << stats.mean_high << "],\"median_ci\":[" << stats.median_low
+        << "," << stats.median_high << "]}";
+}
+
+}  // namespace
+
+SampleStats ComputeStats(std::vector<double> samples) {
+    SampleStats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    const size_t n = samples.size();
+
+    double sum = 0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+    stats.mean = sum / static_cast<double>(n);
+    if (n > 1) {
+        double squares = 0;
+        for (double sample : samples) {
+            squares += (sample - stats.mean) * (sample - stats.mean);
+        }
+        stats.stddev = std::sqrt(squares / static_cast<double>(n - 1));
+    }
+
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.median = Percentile(samples, 0.5);
+    stats.p90 = Percentile(samples, 0.9);
+    stats.p99 = Percentile(samples, 0.99);
+
+    const double root = std::sqrt(static_cast<double>(n));
+    const double margin = kZ * stats.stddev / root;
+    stats.mean_low = stats.mean - margin;
+    stats.mean_high = stats.mean + margin;
+
+    // The 1-based ranks j and k of the order statistics between which the
+    // median lies with 95% probability, clamped to the sample for small n
+    const double half = static_cast<double>(n) / 2;
+    const double low_rank = std::floor(half - kZ * root / 2);
+    const double high_rank = std::ceil(1 + half + kZ * root / 2);
+    const auto j = static_cast<size_t>(std::max(low_rank, 1.0));
+    const auto k = std::min(static_cast<size_t>(high_rank), n);
+    stats.median_low = samples[j - 1];
+    stats.median_high = samples[k - 1];
+    return stats;
+}
+
+BenchmarkResult Summarize(std::string name, size_t iterations,
+                          const std::vector<CPUTimer::Times>& samples,
+                          const BenchmarkOptions& options) {
+    std::vector<double> wall;
+    for (const auto& sample : samples) {
+        wall.push_back(Nanos(sample.wall_time));
+    }
+    std::sort(wall.begin(), wall.end());
+    double low = -INFINITY;
+    double high = INFINITY;
+    if (!wall.empty()) {
+        const double q1 = Percentile(wall, 0.25);
+        const double q3 = Percentile(wall, 0.75);
+        low = q1 - options.outlier_iqr * (q3 - q1);
+        high = q3 + options.outlier_iqr * (q3 - q1);
+    }
+
+    BenchmarkResult result;
+    result.name = std::move(name);
+    result.iterations = iterations;
+    result.samples = samples.size();
+    std::vector<double> wall_per_iteration;
+    std::vector<double> cpu_per_iteration;
+    std::array<double, CPUTimer::Events::kCount> event_sums{};
+    std::array<size_t, CPUTimer::Events::kCount> event_samples{};
+    const auto count = static_cast<double>(iterations);
+    for (const auto& sample : samples) {
+        const double nanos = Nanos(sample.wall_time);
+        if (nanos < low || nanos > high) {
+            ++result.outliers;
+            continue;
+        }
+        wall_per_iteration.push_back(nanos / count);
+        cpu_per_iteration.push_back(Nanos(sample.TotalCpuTime()) / count);
+        for (size_t i = 0; i < CPUTimer::Events::kCount; ++i) {
+            if (const auto& value = sample.events.counts[i]) {
+                event_sums[i] += static_cast<double>(*value) / count;
+                ++event_samples[i];
+            }
+        }
+    }
+    result.wall = ComputeStats(std::move(wall_per_iteration));
+    result.cpu = ComputeStats(std::move(cpu_per_iteration));
+    for (size_t i = 0; i < CPUTimer::Events::kCount; ++i) {
+        if (event_samples[i] > 0) {
+            result.events[i] =
+                event_sums[i] / static_cast<double>(event_samples[i]);
+        }
+    }
+    return result;
+}
+
+void PrintResult(std::ostream& out, const BenchmarkResult& result) {
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "%-32s %12.1f ns [%.1f, %.1f]  p90 %.1f  p99 %.1f  "
+                  "cpu %.1f ns  (%zu x %zu, %zu outliers)",
+                  result.name.c_str(), result.wall.median,
+                  result.wall.median_low, result.wall.median_high,
+                  result.wall.p90, result.wall.p99, result.cpu.median,
+                  result.samples, result.iterations, result.outliers);
+    out << line << '\n';
+}
+
+void WriteJson(std::ostream& out, const BenchmarkResult& result) {
+    const auto precision = out.precision(10);
+    out << "{\"name\":";
+    WriteJsonString(out, result.name);
+    out << ",\"iterations\":" << result.iterations
+        << ",\"samples\":" << result.samples
+        << ",\"outliers\":" << result.outliers << ",\"wall_ns\":";
+    WriteJson(out, result.wall);
+    out << ",\"cpu_ns\":";
+    WriteJson(out, result.cpu);
+    // Only the events that were counted
+    out << ",\"events\":{";
+    bool first = true;
+    for (size_t i = 0; i < CPUTimer::Events::kCount; ++i) {
+        if (result.events[i]) {
+            out << (first ? "" : ",") << '"' << CPUTimer::Events::kNames[i]
+                << "\":" << *result.events[i];
+            first = false;
+        }
+    }
+    out << "}}";
+    out.precision(precision);
+}
+
+void ReportJson(const BenchmarkResult& result) {
+    const char* path = std::getenv("BENCHMARK_JSON");
+    if (path == nullptr || *path == '\0') {
+        return;
+    }
+    std::ofstream out{path, std::ios::app};
+    if (!out) {
+        int err = errno;
+        std::cerr << "Failed to open " << path << ": " << strerror(err)
+                  << std::endl;
+        std::abort();
+    }
+    WriteJson(out, result);
+    out << '\n';
+}
@@ -1,8 +1,12 @@
 #include <benchmark/timer.hpp>
 
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <linux/perf_event.h>
 #include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 namespace {
 
@@ -21,7 +25,95 @@ std::chrono::microseconds ToDuration(timeval d) {
     return std::chrono::microseconds{1'000'000ll * d.tv_sec + d.tv_usec};
 }
 
-CPUTimer::Times GetTimes(CPUTimer::Type type) {
+struct EventConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr uint64_t kDtlbReadMisses =
+    PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+// In the order of CPUTimer::Events::Event
+constexpr EventConfig kEvents[CPUTimer::Events::kCount] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, kDtlbReadMisses},
+};
+
+bool WantCounters(CPUTimer::Counters counters) {
+    switch (counters) {
+    case CPUTimer::DefaultCounters: {
+        const char* value = std::getenv("BENCHMARK_COUNTERS");
+        return value != nullptr && *value != '\0';
+    }
+    case CPUTimer::NoCounters:
+        return false;
+    case CPUTimer::HardwareCounters:
+        return true;
+    default:
+        std::terminate();
+    }
+}
+
+// Counting starts right away. For the whole process only threads created
+// later are counted besides the calling one: perf can't attach to the
+// running ones at once.
+int OpenEvent(const EventConfig& event, CPUTimer::Type type) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = type == CPUTimer::Process;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(
+        ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+std::optional<CPUTimer::Events::Reading> ReadEvent(int fd) {
+    if (fd == -1) {
+        return std::nullopt;
+    }
+    uint64_t values[3];
+    if (::read(fd, values, sizeof(values)) != sizeof(values)) {
+        return std::nullopt;
+    }
+    const auto [count, enabled, running] = values;
+    return CPUTimer::Events::Reading{
+        .count = count,
+        .enabled = enabled,
+        .running = running,
+    };
+}
+
+std::array<int, CPUTimer::Events::kCount> OpenEvents(
+    CPUTimer::Type type, CPUTimer::Counters counters) {
+    std::array<int, CPUTimer::Events::kCount> fds;
+    fds.fill(-1);
+    if (WantCounters(counters)) {
+        for (size_t i = 0; i < fds.size(); ++i) {
+            fds[i] = OpenEvent(kEvents[i], type);
+        }
+    }
+    return fds;
+}
+
+CPUTimer::Times GetTimes(CPUTimer::Type type,
+                         const std::array<int, CPUTimer::Events::kCount>& fds) {
+    CPUTimer::Events events;
+    for (size_t i = 0; i < fds.size(); ++i) {
+        events.readings[i] = ReadEvent(fds[i]);
+        if (events.readings[i]) {
+            events.counts[i] = CPUTimer::Events::Scale(*events.readings[i]);
+        }
+    }
+
     rusage usage;
     if (::getrusage(ToRusageType(type), &usage) < 0) {
         int err = errno;
@@ -33,14 +125,26 @@ CPUTimer::Times GetTimes(CPUTimer::Type type) {
         .wall_time = CPUTimer::WallClock::now().time_since_epoch(),
         .cpu_utime = ToDuration(usage.ru_utime),
         .cpu_stime = ToDuration(usage.ru_stime),
+        .events = events,
     };
 }
 
 }  // namespace
 
-CPUTimer::CPUTimer(Type type) : type_{type}, start_(::GetTimes(type)) {
+CPUTimer::CPUTimer(Type type, Counters counters)
+    : type_{type},
+      perf_fds_(OpenEvents(type, counters)),
+      start_(::GetTimes(type, perf_fds_)) {
+}
+
+CPUTimer::~CPUTimer() {
+    for (int fd : perf_fds_) {
+        if (fd != -1) {
+            ::close(fd);
+        }
+    }
 }
 
 CPUTimer::Times CPUTimer::GetTimes() const {
-    return ::GetTimes(type_) - start_;
+    return ::GetTimes(type_, perf_fds_) - start_;
 }
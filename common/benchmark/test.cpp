@@ -0,0 +1,74 @@
+#include <benchmark/harness.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+TEST_CASE("StatsOfKnownSample") {
+    // 1..100 in a shuffled order
+    std::vector<double> samples(100);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = static_cast<double>(i + 1);
+    }
+    std::shuffle(samples.begin(), samples.end(), std::mt19937{1});
+
+    const auto stats = ComputeStats(samples);
+    CHECK(stats.min == 1);
+    CHECK(stats.max == 100);
+    CHECK(stats.mean == 50.5);
+    CHECK(stats.median == 50.5);
+    CHECK(std::abs(stats.p90 - 90.1) < 1e-9);
+    CHECK(std::abs(stats.p99 - 99.01) < 1e-9);
+    // Sample standard deviation of 1..n is sqrt(n (n + 1) / 12)
+    const double stddev = std::sqrt(100.0 * 101 / 12);
+    CHECK(std::abs(stats.stddev - stddev) < 1e-9);
+    CHECK(std::abs(stats.mean_low - (50.5 - 1.96 * stddev / 10)) < 1e-9);
+    CHECK(std::abs(stats.mean_high - (50.5 + 1.96 * stddev / 10)) < 1e-9);
+    // j = floor(50 - 9.8) = 40, k = ceil(1 + 50 + 9.8) = 61
+    CHECK(stats.median_low == 40);
+    CHECK(stats.median_high == 61);
+}
+
+TEST_CASE("StatsOfSmallSamples") {
+    CHECK(ComputeStats({}).mean == 0);
+
+    const auto single = ComputeStats({7});
+    CHECK(single.stddev == 0);
+    CHECK(single.median_low == 7);
+    CHECK(single.median_high == 7);
+
+    // Ranks fall outside of the sample and are clamped to its ends
+    const auto five = ComputeStats({5, 1, 4, 2, 3});
+    CHECK(five.median == 3);
+    CHECK(five.median_low == 1);
+    CHECK(five.median_high == 5);
+}
+
+TEST_CASE("EventsScaleDelta") {
+    using Reading = CPUTimer::Events::Reading;
+    CPUTimer::Events start;
+    CPUTimer::Events end;
+    // Counted all of the interval, so the delta isn't scaled. Scaling the
+    // ends separately would give 1500 * 5 / 2 - 1000 * 4 / 1 < 0.
+    start.readings[CPUTimer::Events::Cycles] =
+        Reading{.count = 1000, .enabled = 4, .running = 1};
+    end.readings[CPUTimer::Events::Cycles] =
+        Reading{.count = 1500, .enabled = 5, .running = 2};
+    // Never ran during the interval
+    start.readings[CPUTimer::Events::Instructions] =
+        Reading{.count = 10, .enabled = 5, .running = 5};
+    end.readings[CPUTimer::Events::Instructions] =
+        Reading{.count = 10, .enabled = 9, .running = 5};
+    // Missing at one of the ends
+    end.readings[CPUTimer::Events::CacheMisses] =
+        Reading{.count = 1, .enabled = 1, .running = 1};
+
+    const auto delta = end - start;
+    CHECK(delta[CPUTimer::Events::Cycles] == 500);
+    CHECK(!delta[CPUTimer::Events::Instructions]);
+    CHECK(!delta[CPUTimer::Events::CacheMisses]);
+    CHECK(!delta[CPUTimer::Events::DtlbMisses]);
+}
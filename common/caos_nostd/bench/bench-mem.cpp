@@ -0,0 +1,142 @@
+#include <benchmark/run.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// The routines from src/<arch>/mem.S, renamed so that they don't clash with
+// the ones from libc
+extern "C" {
+void* caos_memcpy(void* dst, const void* src, size_t n);
+void* caos_memmove(void* dst, const void* src, size_t n);
+void* caos_memset(void* dst, int c, size_t n);
+int caos_memcmp(const void* lhs, const void* rhs, size_t n);
+}
+
+namespace {
+
+constexpr size_t kSizes[] = {1,   3,   4,    7,    8,    15,      16,
+                             31,  32,  33,   64,   100,  256,     1000,
+                             2048, 4096, 1 << 14, 1 << 16, 1 << 20, 1 << 24};
+constexpr size_t kBytesPerRun = 1 << 28;
+
+int Sign(int value) {
+    return (value > 0) - (value < 0);
+}
+
+// Compares with libc every size up to kAllChecked and some larger ones, which
+// take the rep movsb/stosb path on x86-64, at every alignment. Moves overlap
+// in both directions.
+bool Check() {
+    constexpr size_t kAllChecked = 300;
+    constexpr size_t kMaxChecked = 10000;
+    constexpr size_t kSlack = 64;
+    std::vector<unsigned char> pattern(kMaxChecked + 2 * kSlack);
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        pattern[i] = static_cast<unsigned char>(i * 131 + 7);
+    }
+
+    for (size_t n = 0; n <= kMaxChecked;
+         n = n < kAllChecked ? n + 1 : 2 * n + 1) {
+        for (size_t offset = 0; offset < 16; ++offset) {
+            auto got = pattern;
+            auto expected = pattern;
+            caos_memcpy(got.data() + offset, pattern.data() + kSlack, n);
+            std::memcpy(expected.data() + offset, pattern.data() + kSlack, n);
+            if (got != expected) {
+                std::printf("memcpy of %zu bytes failed\n", n);
+                return false;
+            }
+
+            for (size_t dst : {kSlack - offset, kSlack + offset}) {
+                got = expected = pattern;
+                caos_memmove(got.data() + dst, got.data() + kSlack, n);
+                std::memmove(expected.data() + dst, expected.data() + kSlack,
+                             n);
+                if (got != expected) {
+                    std::printf("memmove of %zu bytes by %zu failed\n", n,
+                                offset);
+                    return false;
+                }
+            }
+
+            got = expected = pattern;
+            caos_memset(got.data() + offset, 0x1AB, n);
+            std::memset(expected.data() + offset, 0x1AB, n);
+            if (got != expected) {
+                std::printf("memset of %zu bytes failed\n", n);
+                return false;
+            }
+
+            got = pattern;
+            const size_t step = std::max<size_t>(n / 7, 1);
+            for (size_t diff = 0; diff <= n; diff += step) {
+                if (diff < n) {
+                    got[offset + diff] ^= 0x80;
+                }
+                int result = caos_memcmp(got.data() + offset,
+                                         pattern.data() + offset, n);
+                int reference = std::memcmp(got.data() + offset,
+                                            pattern.data() + offset, n);
+                if (Sign(result) != Sign(reference)) {
+                    std::printf("memcmp of %zu bytes failed\n", n);
+                    return false;
+                }
+                if (diff < n) {
+                    got[offset + diff] ^= 0x80;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+template <class F>
+double NanosPerCall(F&& f, size_t calls) {
+    auto times = RunWithWarmup(f, calls / 10 + 1, calls);
+    return std::chrono::duration<double, std::nano>(times.wall_time).count() /
+           calls;
+}
+
+void Report(const char* name, size_t size, double ours, double libc) {
+    std::printf("%-8s %10zu %12.1f %12.1f %8.2f %10.2f\n", name, size, ours,
+                libc, libc / ours, size / ours);
+}
+
+}  // namespace
+
+int main() {
+    if (!Check()) {
+        return 1;
+    }
+
+    std::printf("%-8s %10s %12s %12s %8s %10s\n", "function", "size",
+                "ours, ns", "libc, ns", "speedup", "GB/s");
+    for (size_t size : kSizes) {
+        const size_t calls = std::max<size_t>(kBytesPerRun / size / 16, 10);
+        std::vector<char> src(size + 64, 'a');
+        std::vector<char> dst(size + 64, 'a');
+        // Volatile, so that the compiler doesn't inline libc's versions
+        static volatile size_t n;
+        n = size;
+        char* d = dst.data();
+        const char* s = src.data();
+
+        Report("memcpy", size,
+               NanosPerCall([=] { return caos_memcpy(d, s, n); }, calls),
+               NanosPerCall([=] { return std::memcpy(d, s, n); }, calls));
+        Report("memmove", size,
+               NanosPerCall([=] { return caos_memmove(d + 1, d, n); }, calls),
+               NanosPerCall([=] { return std::memmove(d + 1, d, n); }, calls));
+        Report("memset", size,
+               NanosPerCall([=] { return caos_memset(d, 0, n); }, calls),
+               NanosPerCall([=] { return std::memset(d, 0, n); }, calls));
+        std::memset(d, 'a', size);
+        Report("memcmp", size,
+               NanosPerCall([=] { return caos_memcmp(d, s, n); }, calls),
+               NanosPerCall([=] { return std::memcmp(d, s, n); }, calls));
+    }
+}
@@ -5,7 +5,8 @@
 
 #include <macros.hpp>
 
-// Variation of assert that makes debugging much more fun
+// Variation of assert that makes debugging much more fun. Doesn't flush the
+// buffered writers: it's used by their implementation.
 #define ASSERT_NO_REPORT(cond)                                                 \
     do {                                                                       \
         if (!(cond)) {                                                         \
@@ -16,6 +17,7 @@
 #define ASSERT_M(cond, message)                                                \
     do {                                                                       \
         if (!(cond)) {                                                         \
+            ::nostd::FlushAll();                                               \
             ::nostd::EPrint("Line " STRINGIFY(                                 \
                 __LINE__) " Condition " #cond " failed: " message "\n");       \
             ::Exit(1);                                                         \
@@ -25,6 +27,7 @@
 #define ASSERT_NO_M(cond)                                                      \
     do {                                                                       \
         if (!(cond)) {                                                         \
+            ::nostd::FlushAll();                                               \
             ::nostd::EPrint("Line " STRINGIFY(__LINE__) " Condition " #cond    \
                                                         "\n");                 \
             ::Exit(1);                                                         \
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+namespace nostd {
+
+// Minimal io_uring: requests are queued with Prepare* and handed to the
+// kernel in one batch by Submit, completions are read from the shared ring
+// without syscalls. Nothing is allocated, the rings are mapped from the
+// kernel. Not thread safe.
+class IoUring {
+  public:
+    struct Completion {
+        uint64_t user_data;
+        // Same as the result of the synchronous syscall, but -errno on error
+        int32_t result;
+        uint32_t flags;
+    };
+
+    IoUring() = default;
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    ~IoUring();
+
+    // Creates a ring for up to entries queued requests (rounded up to a
+    // power of two by the kernel). Called once. Returns -1 and sets Errno on
+    // failure.
+    int Init(unsigned entries);
+
+    // Queue a request, return false if the submission queue is full. The
+    // buffers must stay valid until the request completes.
+    bool PrepareRead(int fd, void* buf, unsigned len, uint64_t offset,
+                     uint64_t user_data);
+    bool PrepareWrite(int fd, const void* buf, unsigned len, uint64_t offset,
+                      uint64_t user_data);
+    bool PrepareFsync(int fd, bool datasync, uint64_t user_data);
+
+    // Submits all queued requests with a single syscall and waits until at
+    // least wait_for of them completed. Returns the number of submitted
+    // requests or -1 with Errno set.
+    int Submit(unsigned wait_for = 0);
+
+    // Pops a completion if there is one, never enters the kernel
+    bool PeekCompletion(Completion* completion);
+
+    // Pops a completion, waiting for it if needed. Returns -1 with Errno set
+    // if waiting failed.
+    int WaitCompletion(Completion* completion);
+
+    // Calls f for every available completion and releases them all at once
+    template <class F>
+    unsigned DrainCompletions(F&& f) {
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned head = *cq_head_;
+        const unsigned count = tail - head;
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            f(Completion{cqe.user_data, cqe.res, cqe.flags});
+        }
+        __atomic_store_n(cq_head_, tail, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    // Requests queued but not submitted yet
+    unsigned Queued() const {
+        return sqe_tail_ - submitted_;
+    }
+
+  private:
+    io_uring_sqe* NextSqe();
+
+    int fd_ = -1;
+
+    void* sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    // Local copy of the tail, published to the kernel by Submit
+    unsigned sqe_tail_ = 0;
+    unsigned submitted_ = 0;
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned cq_mask_ = 0;
+};
+
+}  // namespace nostd
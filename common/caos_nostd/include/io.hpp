@@ -1,6 +1,9 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/uio.h>
 
 namespace nostd {
 
@@ -9,6 +12,54 @@ void EPrint(const char* message);
 void PrintTo(int fd, const char* message);
 int WriteAll(int fd, const char* buf, size_t len);
 
+// Writes all iovcnt buffers with as few syscalls as possible. Partial writes
+// are resumed from where they stopped, so iov is modified. Returns the total
+// size or -1 with Errno set.
+ssize_t WriteAllV(int fd, struct iovec* iov, int iovcnt);
+
+// Copies count bytes from the current position of in_fd inside the kernel.
+// Stops early at the end of in_fd. Returns the number of copied bytes or -1
+// with Errno set.
+ssize_t SendFileAll(int out_fd, int in_fd, size_t count);
+
+// Collects output in a fixed buffer and writes it with one syscall when the
+// buffer is full or on Flush. Out() and Err() are flushed when Main returns
+// and by failing ASSERTs, but not by Exit or ExecVE: flush before them. A
+// program whose output failed to be written exits with 1 instead of 0.
+class Writer {
+  public:
+    static constexpr size_t kBufferSize = 4096;
+
+    constexpr explicit Writer(int fd) : fd_{fd} {
+    }
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    Writer& Write(const char* data, size_t len);
+    Writer& Print(const char* str);
+    Writer& Print(char c);
+    Writer& PrintInt(int64_t value);
+    Writer& PrintUInt(uint64_t value);
+    // Lowercase digits without a prefix, zero-padded to min_digits
+    Writer& PrintHex(uint64_t value, size_t min_digits = 1);
+
+    // Returns -1 if this or any earlier write failed, the data is dropped
+    // then. Like the error flag of a FILE, the failure sticks.
+    int Flush();
+
+  private:
+    int fd_;
+    size_t size_ = 0;
+    bool failed_ = false;
+    char buffer_[kBufferSize] = {};
+};
+
+Writer& Out();
+Writer& Err();
+// Flushes Out() and Err(), returns -1 if either failed
+int FlushAll();
+
 }  // namespace nostd
 
 [[deprecated("Use nostd::Print")]] void Print(const char* message);
@@ -1,3 +1,4 @@
+#include <io.hpp>
 #include <syscalls.hpp>
 
 #include <cstdint>
@@ -11,7 +12,17 @@ extern "C" [[noreturn]] void Entry(uintptr_t* args) {
     char** argv = reinterpret_cast<char**>(args + 1);
     Environ = argv + argc + 1;
 
+    char** env_end = Environ;
+    while (*env_end != nullptr) {
+        ++env_end;
+    }
+    InitAuxv(reinterpret_cast<uintptr_t*>(env_end + 1));
+
     int code = Main(static_cast<int>(argc), argv, Environ);
 
+    // Output lost on a full disk or a closed pipe is a failure too
+    if (nostd::FlushAll() == -1 && code == 0) {
+        code = 1;
+    }
     Exit(code);
 }
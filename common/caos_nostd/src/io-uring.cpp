@@ -0,0 +1,180 @@
+#include <io-uring.hpp>
+#include <syscalls.hpp>
+
+#include <sys/mman.h>
+
+namespace nostd {
+
+namespace {
+
+template <class T>
+T* At(void* base, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+}  // namespace
+
+IoUring::~IoUring() {
+    if (sqes_ != nullptr) {
+        MUnMap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+        MUnMap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr) {
+        MUnMap(sq_ring_, sq_ring_size_);
+    }
+    if (fd_ != -1) {
+        Close(fd_);
+    }
+}
+
+int IoUring::Init(unsigned entries) {
+    io_uring_params params{};
+    fd_ = IoUringSetup(entries, &params);
+    if (fd_ == -1) {
+        return -1;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    // Both rings share one mapping on kernels since 5.4
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        if (cq_ring_size_ > sq_ring_size_) {
+            sq_ring_size_ = cq_ring_size_;
+        }
+        cq_ring_size_ = sq_ring_size_;
+    }
+
+    void* sq_ring = MMap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) {
+        return -1;
+    }
+    sq_ring_ = sq_ring;
+
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        void* cq_ring =
+            MMap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) {
+            return -1;
+        }
+        cq_ring_ = cq_ring;
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = MMap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return -1;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    sq_head_ = At<unsigned>(sq_ring_, params.sq_off.head);
+    sq_tail_ = At<unsigned>(sq_ring_, params.sq_off.tail);
+    sq_array_ = At<unsigned>(sq_ring_, params.sq_off.array);
+    sq_mask_ = *At<unsigned>(sq_ring_, params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sqe_tail_ = submitted_ = *sq_tail_;
+
+    cq_head_ = At<unsigned>(cq_ring_, params.cq_off.head);
+    cq_tail_ = At<unsigned>(cq_ring_, params.cq_off.tail);
+    cqes_ = At<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+    cq_mask_ = *At<unsigned>(cq_ring_, params.cq_off.ring_mask);
+    return 0;
+}
+
+io_uring_sqe* IoUring::NextSqe() {
+    const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= sq_entries_) {
+        return nullptr;
+    }
+    const unsigned index = sqe_tail_++ & sq_mask_;
+    sq_array_[index] = index;
+    io_uring_sqe* sqe = &sqes_[index];
+    *sqe = {};
+    return sqe;
+}
+
+bool IoUring::PrepareRead(int fd, void* buf, unsigned len, uint64_t offset,
+                          uint64_t user_data) {
+    io_uring_sqe* sqe = NextSqe();
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IoUring::PrepareWrite(int fd, const void* buf, unsigned len,
+                           uint64_t offset, uint64_t user_data) {
+    io_uring_sqe* sqe = NextSqe();
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IoUring::PrepareFsync(int fd, bool datasync, uint64_t user_data) {
+    io_uring_sqe* sqe = NextSqe();
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = fd;
+    sqe->fsync_flags = datasync ? IORING_FSYNC_DATASYNC : 0;
+    sqe->user_data = user_data;
+    return true;
+}
+
+int IoUring::Submit(unsigned wait_for) {
+    // The entries must be visible to the kernel before the new tail
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+    const unsigned to_submit = sqe_tail_ - submitted_;
+    const unsigned flags = wait_for > 0 ? IORING_ENTER_GETEVENTS : 0;
+    const int submitted =
+        IoUringEnter(fd_, to_submit, wait_for, flags, nullptr, 0);
+    if (submitted != -1) {
+        submitted_ += static_cast<unsigned>(submitted);
+    }
+    return submitted;
+}
+
+bool IoUring::PeekCompletion(Completion* completion) {
+    const unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+    *completion = {cqe.user_data, cqe.res, cqe.flags};
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+int IoUring::WaitCompletion(Completion* completion) {
+    while (!PeekCompletion(completion)) {
+        // Also submits whatever is queued
+        if (Submit(1) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+}  // namespace nostd
@@ -24,6 +24,49 @@ int WriteAll(int fd, const char* message, size_t len) {
     return static_cast<int>(len);
 }
 
+ssize_t WriteAllV(int fd, struct iovec* iov, int iovcnt) {
+    ssize_t total = 0;
+    while (iovcnt > 0) {
+        auto ret = WriteV(fd, iov, iovcnt);
+        if (ret == -1) {
+            return ret;
+        }
+        total += ret;
+
+        // Skip the buffers written completely, cut the partially written one
+        auto written = static_cast<size_t>(ret);
+        while (iovcnt > 0 && written >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        } else {
+            ASSERT_NO_REPORT(written == 0);
+        }
+    }
+
+    return total;
+}
+
+ssize_t SendFileAll(int out_fd, int in_fd, size_t count) {
+    size_t copied = 0;
+    while (copied < count) {
+        auto ret = SendFile(out_fd, in_fd, nullptr, count - copied);
+        if (ret == -1) {
+            return ret;
+        }
+        if (ret == 0) {
+            break;
+        }
+        copied += static_cast<size_t>(ret);
+    }
+
+    return static_cast<ssize_t>(copied);
+}
+
 void PrintTo(int fd, const char* message) {
     int written = WriteAll(fd, message, StrLen(message));
     ASSERT_NO_REPORT(written != -1);
@@ -37,6 +80,105 @@ void EPrint(const char* message) {
     PrintTo(STDERR_FILENO, message);
 }
 
+namespace {
+
+// Constant-initialized, so they need neither constructors nor guards
+constinit Writer out{STDOUT_FILENO};
+constinit Writer err{STDERR_FILENO};
+
+// Enough for the digits of any 64-bit value
+constexpr size_t kMaxDigits = 20;
+
+}  // namespace
+
+Writer& Writer::Write(const char* data, size_t len) {
+    if (size_ + len > kBufferSize) {
+        Flush();
+        // Too big to be worth copying
+        if (len >= kBufferSize) {
+            if (WriteAll(fd_, data, len) == -1) {
+                failed_ = true;
+            }
+            return *this;
+        }
+    }
+    for (size_t i = 0; i < len; ++i) {
+        buffer_[size_ + i] = data[i];
+    }
+    size_ += len;
+    return *this;
+}
+
+Writer& Writer::Print(const char* str) {
+    return Write(str, StrLen(str));
+}
+
+Writer& Writer::Print(char c) {
+    if (size_ == kBufferSize) {
+        Flush();
+    }
+    buffer_[size_++] = c;
+    return *this;
+}
+
+Writer& Writer::PrintInt(int64_t value) {
+    if (value < 0) {
+        Print('-');
+        // Negated as unsigned to handle the minimum value
+        return PrintUInt(-static_cast<uint64_t>(value));
+    }
+    return PrintUInt(value);
+}
+
+Writer& Writer::PrintUInt(uint64_t value) {
+    char digits[kMaxDigits];
+    char* begin = digits + kMaxDigits;
+    do {
+        *--begin = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    return Write(begin, digits + kMaxDigits - begin);
+}
+
+Writer& Writer::PrintHex(uint64_t value, size_t min_digits) {
+    constexpr size_t kMaxHexDigits = 16;
+    if (min_digits > kMaxHexDigits) {
+        min_digits = kMaxHexDigits;
+    }
+
+    char digits[kMaxHexDigits];
+    char* begin = digits + kMaxHexDigits;
+    do {
+        *--begin = "0123456789abcdef"[value & 0xf];
+        value >>= 4;
+    } while (value != 0 || digits + kMaxHexDigits - begin <
+                               static_cast<ptrdiff_t>(min_digits));
+    return Write(begin, digits + kMaxHexDigits - begin);
+}
+
+int Writer::Flush() {
+    const size_t size = size_;
+    size_ = 0;
+    if (size != 0 && WriteAll(fd_, buffer_, size) == -1) {
+        failed_ = true;
+    }
+    return failed_ ? -1 : 0;
+}
+
+Writer& Out() {
+    return out;
+}
+
+Writer& Err() {
+    return err;
+}
+
+int FlushAll() {
+    const int out_result = out.Flush();
+    const int err_result = err.Flush();
+    return out_result == -1 || err_result == -1 ? -1 : 0;
+}
+
 }  // namespace nostd
 
 int WriteAll(int fd, const char* message, size_t len) {
@@ -1,14 +1,37 @@
 #include <strings.hpp>
 
+#include <cstdint>
+
 namespace nostd {
 
-size_t StrLen(const char* str) {
-    size_t len = 0;
-    while (*str != '\0') {
-        ++str;
-        ++len;
+namespace {
+
+using Word = uint64_t __attribute__((may_alias));
+
+constexpr uint64_t kLowBits = 0x0101010101010101;
+constexpr uint64_t kHighBits = 0x8080808080808080;
+
+// Has false positives only above a real zero byte, so the lowest set bit is
+// always right
+uint64_t ZeroBytes(uint64_t word) {
+    return (word - kLowBits) & ~word & kHighBits;
+}
+
+}  // namespace
+
+// Reads aligned words, which never cross a page boundary, so the bytes read
+// past the end of the string can't fault
+__attribute__((no_sanitize_address)) size_t StrLen(const char* str) {
+    const auto address = reinterpret_cast<uintptr_t>(str);
+    const auto* word = reinterpret_cast<const Word*>(address & ~uintptr_t{7});
+    // Bytes before str are forced to be non-zero (little-endian)
+    const unsigned skipped = (address & 7) * 8;
+    uint64_t zeros = ZeroBytes(*word | ((uint64_t{1} << skipped) - 1));
+    while (zeros == 0) {
+        zeros = ZeroBytes(*++word);
     }
-    return len;
+    return reinterpret_cast<const char*>(word) - str +
+           __builtin_ctzll(zeros) / 8;
 }
 
 }  // namespace nostd
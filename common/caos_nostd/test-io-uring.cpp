@@ -0,0 +1,138 @@
+#include <assert.hpp>
+#include <io-uring.hpp>
+#include <syscalls.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+
+namespace {
+
+constexpr unsigned kEntries = 4;
+// Several times the ring, so that it fills up
+constexpr size_t kBlocks = 4 * kEntries + 3;
+constexpr unsigned kBlockSize = 512;
+
+char blocks[kBlocks][kBlockSize];
+char read_back[kBlocks][kBlockSize];
+
+// Every completion must be a successful transfer of a whole block, which
+// wasn't completed before
+void MarkDone(nostd::IoUring::Completion c, bool* done) {
+    ASSERT(c.user_data < kBlocks);
+    ASSERT(c.result == static_cast<int32_t>(kBlockSize));
+    ASSERT(!done[c.user_data]);
+    done[c.user_data] = true;
+}
+
+// Returns the number of completions
+unsigned DrainBlocks(nostd::IoUring& ring, bool* done) {
+    return ring.DrainCompletions(
+        [done](nostd::IoUring::Completion c) { MarkDone(c, done); });
+}
+
+// Queues a request for every block, submitting whenever the ring is full,
+// then waits for all of them
+template <class Prepare>
+void TransferBlocks(nostd::IoUring& ring, Prepare prepare) {
+    bool done[kBlocks] = {};
+    unsigned completed = 0;
+    bool was_full = false;
+    for (size_t i = 0; i < kBlocks; ++i) {
+        while (!prepare(i)) {
+            was_full = true;
+            ASSERT(ring.Queued() == kEntries);
+            ASSERT(ring.Submit(1) == static_cast<int>(kEntries));
+            ASSERT(ring.Queued() == 0);
+            completed += DrainBlocks(ring, done);
+        }
+    }
+    ASSERT(was_full);
+
+    const unsigned queued = ring.Queued();
+    ASSERT(ring.Submit(0) == static_cast<int>(queued));
+    while (completed < kBlocks) {
+        nostd::IoUring::Completion c;
+        ASSERT(ring.WaitCompletion(&c) == 0);
+        MarkDone(c, done);
+        ++completed;
+        completed += DrainBlocks(ring, done);
+    }
+}
+
+}  // namespace
+
+void TestWriteFsyncRead(nostd::IoUring& ring) {
+    int file = Open("/tmp", O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    ASSERT(file != -1);
+
+    for (size_t i = 0; i < kBlocks; ++i) {
+        for (size_t j = 0; j < kBlockSize; ++j) {
+            blocks[i][j] = static_cast<char>('a' + (i + j) % 26);
+        }
+    }
+
+    TransferBlocks(ring, [&ring, file](size_t i) {
+        return ring.PrepareWrite(file, blocks[i], kBlockSize, i * kBlockSize,
+                                 i);
+    });
+
+    ASSERT(ring.PrepareFsync(file, /*datasync=*/true, kBlocks));
+    ASSERT(ring.Submit(1) == 1);
+    nostd::IoUring::Completion c;
+    ASSERT(ring.WaitCompletion(&c) == 0);
+    ASSERT(c.user_data == kBlocks);
+    ASSERT(c.result == 0);
+    ASSERT(!ring.PeekCompletion(&c));
+
+    TransferBlocks(ring, [&ring, file](size_t i) {
+        return ring.PrepareRead(file, read_back[i], kBlockSize,
+                                i * kBlockSize, i);
+    });
+    ASSERT(std::memcmp(blocks, read_back, sizeof(blocks)) == 0);
+
+    Close(file);
+}
+
+void TestBadFd(nostd::IoUring& ring) {
+    char buf[16];
+    ASSERT(ring.PrepareRead(-1, buf, sizeof(buf), 0, 7));
+    // The request is submitted, the error comes with its completion
+    ASSERT(ring.Submit(1) == 1);
+    nostd::IoUring::Completion c;
+    ASSERT(ring.PeekCompletion(&c));
+    ASSERT(c.user_data == 7);
+    ASSERT(c.result == -EBADF);
+    ASSERT(!ring.PeekCompletion(&c));
+}
+
+void TestDrainCompletions(nostd::IoUring& ring) {
+    int file = Open("/dev/zero", O_RDONLY | O_CLOEXEC, 0);
+    ASSERT(file != -1);
+
+    for (size_t i = 0; i < kEntries; ++i) {
+        ASSERT(ring.PrepareRead(file, read_back[i], kBlockSize, 0, i));
+    }
+    ASSERT(!ring.PrepareRead(file, read_back[0], kBlockSize, 0, 0));
+    ASSERT(ring.Submit(kEntries) == static_cast<int>(kEntries));
+
+    bool done[kBlocks] = {};
+    ASSERT(DrainBlocks(ring, done) == kEntries);
+    for (size_t i = 0; i < kEntries; ++i) {
+        ASSERT(done[i]);
+    }
+    ASSERT(DrainBlocks(ring, done) == 0);
+
+    Close(file);
+}
+
+int Main(int, char**, char**) {
+    nostd::IoUring ring;
+    ASSERT(ring.Init(kEntries) == 0);
+
+    RUN_TEST(TestWriteFsyncRead, ring);
+    RUN_TEST(TestBadFd, ring);
+    RUN_TEST(TestDrainCompletions, ring);
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <assert.hpp>
+#include <io.hpp>
+#include <syscalls.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+namespace {
+
+// Reads exactly len bytes from a pipe which already holds them
+bool ReadsBack(int fd, const char* expected, size_t len) {
+    char buf[64];
+    ASSERT(len <= sizeof(buf));
+    size_t got = 0;
+    while (got < len) {
+        auto ret = Read(fd, buf + got, len - got);
+        if (ret <= 0) {
+            return false;
+        }
+        got += static_cast<size_t>(ret);
+    }
+    return std::memcmp(buf, expected, len) == 0;
+}
+
+}  // namespace
+
+void TestWriteAllVPipe() {
+    int fds[2];
+    ASSERT(Pipe2(fds, O_CLOEXEC) == 0);
+
+    char a[] = "ab";
+    char b[] = "cde";
+    // Empty buffers at the start, in the middle and at the end
+    iovec iov[] = {
+        {a, 0}, {a, 2}, {b, 0}, {b, 0}, {b, 3}, {a, 0},
+    };
+    ASSERT(nostd::WriteAllV(fds[1], iov, 6) == 5);
+    ASSERT(ReadsBack(fds[0], "abcde", 5));
+
+    // Nothing to write at all
+    iovec empty[] = {{a, 0}, {b, 0}};
+    ASSERT(nostd::WriteAllV(fds[1], empty, 2) == 0);
+    ASSERT(nostd::WriteAllV(fds[1], empty, 0) == 0);
+
+    Close(fds[0]);
+    Close(fds[1]);
+}
+
+// A single writev transfers at most MAX_RW_COUNT (2 GiB minus a page), so a
+// bigger batch is written partially and resumed in the middle of a buffer.
+// /dev/null never touches the memory, so the pages are never populated.
+void TestWriteAllVPartial() {
+    constexpr size_t kGiB = size_t{1} << 30;
+    void* data = MMap(nullptr, kGiB, PROT_READ,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    ASSERT(data != MAP_FAILED);
+
+    int fd = Open("/dev/null", O_WRONLY | O_CLOEXEC, 0);
+    ASSERT(fd != -1);
+
+    iovec iov[] = {
+        {data, kGiB}, {data, 0}, {data, kGiB}, {data, 0}, {data, kGiB},
+    };
+    ASSERT(nostd::WriteAllV(fd, iov, 5) == static_cast<ssize_t>(3 * kGiB));
+    // The first call stopped inside the second buffer, the second one
+    // resumed from there
+    ASSERT(iov[2].iov_len < kGiB);
+    ASSERT(iov[2].iov_base != data);
+
+    Close(fd);
+    MUnMap(data, kGiB);
+}
+
+void TestWriteAllVError() {
+    iovec iov[] = {{const_cast<char*>("x"), 1}};
+    ASSERT(nostd::WriteAllV(-1, iov, 1) == -1);
+    ASSERT(Errno == EBADF);
+}
+
+void TestSendFileAll() {
+    int file = Open("/tmp", O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    ASSERT(file != -1);
+    // Written at an offset, so the file position stays at the start
+    char content[] = "0123456789";
+    iovec iov[] = {{content, 10}};
+    ASSERT(PWriteV2(file, iov, 1, 0, 0) == 10);
+
+    int fds[2];
+    ASSERT(Pipe2(fds, O_CLOEXEC) == 0);
+
+    ASSERT(nostd::SendFileAll(fds[1], file, 4) == 4);
+    ASSERT(ReadsBack(fds[0], "0123", 4));
+    // The end of the file comes before count
+    ASSERT(nostd::SendFileAll(fds[1], file, 100) == 6);
+    ASSERT(ReadsBack(fds[0], "456789", 6));
+    ASSERT(nostd::SendFileAll(fds[1], file, 100) == 0);
+
+    ASSERT(nostd::SendFileAll(-1, file, 1) == -1);
+    ASSERT(Errno == EBADF);
+
+    Close(fds[0]);
+    Close(fds[1]);
+    Close(file);
+}
+
+void TestWriterError() {
+    int fds[2];
+    ASSERT(Pipe2(fds, O_CLOEXEC) == 0);
+    nostd::Writer good{fds[1]};
+    good.Print("ok ").PrintInt(-42);
+    ASSERT(good.Flush() == 0);
+    ASSERT(ReadsBack(fds[0], "ok -42", 6));
+    Close(fds[0]);
+    Close(fds[1]);
+
+    nostd::Writer buffered{-1};
+    buffered.Print("lost");
+    ASSERT(buffered.Flush() == -1);
+    // The failure sticks even with nothing left to write
+    ASSERT(buffered.Flush() == -1);
+
+    // Big writes bypass the buffer, their failure is reported as well
+    static char big[nostd::Writer::kBufferSize];
+    nostd::Writer direct{-1};
+    direct.Write(big, sizeof(big));
+    ASSERT(direct.Flush() == -1);
+}
+
+int Main(int, char**, char**) {
+    RUN_TEST(TestWriteAllVPipe);
+    RUN_TEST(TestWriteAllVPartial);
+    RUN_TEST(TestWriteAllVError);
+    RUN_TEST(TestSendFileAll);
+    RUN_TEST(TestWriterError);
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <string_view>
+
+// Writes all of data, retrying on short writes and EINTR
+bool WriteAll(int fd, std::string_view data);
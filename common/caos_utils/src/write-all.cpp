@@ -0,0 +1,19 @@
+#include <write-all.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <unistd.h>
+
+bool WriteAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t ret = write(fd, data.data(), data.size());
+        if (ret == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(ret));
+    }
+    return true;
+}
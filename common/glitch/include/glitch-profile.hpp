@@ -0,0 +1,101 @@
+#pragma once
+
+#include <glitch.hpp>
+
+#include <pcg-random.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string_view>
+
+// Adversarial kernel behaviour for robustness benchmarks. Probabilities are
+// in [0, 1] and every decision is drawn from PCGRandom seeded with seed, so
+// runs are reproducible.
+struct GlitchProfile {
+    uint64_t seed = 42;
+
+    // Reads and writes transfer a random nonempty prefix of the request
+    double short_read = 0;
+    double short_write = 0;
+
+    // Reads and writes fail with EINTR, then up to eintr_burst - 1 calls in
+    // a row fail the same way
+    double eintr = 0;
+    uint32_t eintr_burst = 1;
+
+    // Reads and writes sleep for delay_ns plus an exponentially distributed
+    // time with mean jitter_ns
+    uint64_t delay_ns = 0;
+    uint64_t jitter_ns = 0;
+
+    // fork fails with EAGAIN
+    double fork_failure = 0;
+
+    // Parses comma-separated key=value pairs with the names of the fields,
+    // optionally starting with a preset: short-io, eintr-storm, slow-io,
+    // fork-failures or hostile. For example "eintr-storm,seed=7". Returns
+    // nullopt if the spec is malformed.
+    static std::optional<GlitchProfile> Parse(std::string_view spec);
+};
+
+// Applies the profile to read, write, their p*/chk variants and fork, then
+// passes the calls on to the hooks installed before it. With
+// GlitchScope::Process the random state is shared by all threads without
+// their own hooks: draws are serialized, but only reproducible in
+// single-threaded runs.
+class ProfileGlitches final : ReadGuard,
+                              ReadChkGuard,
+                              PReadGuard,
+                              PReadChkGuard,
+                              WriteGuard,
+                              PWriteGuard,
+                              ForkGuard {
+  public:
+    // How many times each glitch was injected
+    struct Stats {
+        uint64_t short_reads = 0;
+        uint64_t short_writes = 0;
+        uint64_t interrupts = 0;
+        uint64_t delays = 0;
+        uint64_t fork_failures = 0;
+    };
+
+    explicit ProfileGlitches(const GlitchProfile& profile,
+                             GlitchScope scope = GlitchScope::Thread);
+
+    Stats GetStats() const {
+        std::lock_guard lock{mutex_};
+        return stats_;
+    }
+
+  private:
+    ssize_t Read(int fd, void* buf, size_t count) override;
+    ssize_t ReadChk(int fd, void* buf, size_t count, size_t buflen) override;
+    ssize_t PRead(int fd, void* buf, size_t count, off_t offset) override;
+    ssize_t PReadChk(int fd, void* buf, size_t count, off_t offset,
+                     size_t buflen) override;
+    ssize_t Write(int fd, const void* buf, size_t count) override;
+    ssize_t PWrite(int fd, const void* buf, size_t count,
+                   off_t offset) override;
+    pid_t Fork() override;
+
+    // Called with mutex_ held
+    bool Chance(double probability);
+    // Sleeps, then decides whether the call fails with EINTR and, if it
+    // doesn't, whether it transfers only a prefix of count. Returns true if
+    // the call fails.
+    bool Interrupt(double short_probability, size_t* count,
+                   uint64_t* shortened);
+
+    const GlitchProfile profile_;
+    // Guards everything below, the calls themselves are made without it
+    mutable std::mutex mutex_;
+    PCGRandom rng_;
+    uint32_t pending_interrupts_ = 0;
+    Stats stats_;
+};
+
+// Installs a profile parsed from GLITCH_PROFILE for the whole run, called
+// before main. Aborts if the variable is set but malformed.
+bool InstallProfileFromEnv();
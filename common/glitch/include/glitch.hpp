@@ -1,22 +1,39 @@
 #pragma once
 
 #include <macros.hpp>
+
+#include <atomic>
 #include <sys/types.h>
 
+// Where a guard installs its hook. Thread hooks form a stack per thread and
+// are consulted first, process hooks are seen by threads without their own.
+enum class GlitchScope {
+    Thread,
+    Process,
+};
+
+// Next##name passes a call on to the hook that was active before the guard:
+// the previous hook of its scope, then the process hook for thread guards,
+// then the real function
 #define XX(name, cname, ret, ...)                                              \
     struct name##Hook {                                                        \
         virtual ret name(ARGS_MAP(ARG_DECL, __VA_ARGS__)) = 0;                 \
     };                                                                         \
                                                                                \
     ret Real##name(ARGS_MAP(ARG_DECL, __VA_ARGS__));                           \
-    extern name##Hook* name##Impl;                                             \
+    extern thread_local name##Hook* name##Impl;                                \
+    extern std::atomic<name##Hook*> name##GlobalImpl;                          \
                                                                                \
     struct name##Guard : name##Hook {                                          \
-        name##Guard();                                                         \
+        explicit name##Guard(GlitchScope scope = GlitchScope::Thread);         \
         ~name##Guard();                                                        \
                                                                                \
+      protected:                                                               \
+        ret Next##name(ARGS_MAP(ARG_DECL, __VA_ARGS__));                       \
+                                                                               \
       private:                                                                 \
         name##Hook* prev_hook_;                                                \
+        GlitchScope scope_;                                                    \
     };
 
 #define GLITCH_INTERNALS
@@ -1,9 +1,28 @@
+#include "record.hpp"
+
 #include <glitch.hpp>
+#include <glitch-profile.hpp>
 
+#include <chrono>
+#include <cstdint>
 #include <utility>  // IWYU pragma: keep (used in macro expansion)
 
+namespace {
+
+uint64_t ElapsedNanos(std::chrono::steady_clock::time_point start) {
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+        .count();
+}
+
+// Referenced from here so that the profile code is always linked in
+[[maybe_unused]] const bool kProfileInstalled = InstallProfileFromEnv();
+
+}  // namespace
+
 #define XX(name, cname, ret, ...)                                              \
-    name##Hook* name##Impl = nullptr;                                          \
+    thread_local name##Hook* name##Impl = nullptr;                             \
+    std::atomic<name##Hook*> name##GlobalImpl = nullptr;                       \
                                                                                \
     extern "C" ret __real_##cname(ARGS_MAP(ARG_DECL, __VA_ARGS__));            \
                                                                                \
@@ -11,18 +30,54 @@
         return __real_##cname(ARGS_MAP(ARG_NAME, __VA_ARGS__));                \
     }                                                                          \
                                                                                \
-    extern "C" ret __wrap_##cname(ARGS_MAP(ARG_DECL, __VA_ARGS__)) {           \
+    static ret Dispatch##name(ARGS_MAP(ARG_DECL, __VA_ARGS__)) {               \
         if (auto hook = name##Impl) {                                          \
             return hook->name(ARGS_MAP(ARG_NAME, __VA_ARGS__));                \
         }                                                                      \
+        if (auto hook = name##GlobalImpl.load(std::memory_order_acquire)) {    \
+            return hook->name(ARGS_MAP(ARG_NAME, __VA_ARGS__));                \
+        }                                                                      \
         return Real##name(ARGS_MAP(ARG_NAME, __VA_ARGS__));                    \
     }                                                                          \
                                                                                \
-    name##Guard::name##Guard() : prev_hook_(std::exchange(name##Impl, this)) { \
+    extern "C" ret __wrap_##cname(ARGS_MAP(ARG_DECL, __VA_ARGS__)) {           \
+        if (kGlitchRecording) [[unlikely]] {                                   \
+            const auto start = std::chrono::steady_clock::now();               \
+            ret result = Dispatch##name(ARGS_MAP(ARG_NAME, __VA_ARGS__));      \
+            RecordCall(GlitchCall::name,                                       \
+                       RequestedBytes(ARGS_MAP(ARG_NAME, __VA_ARGS__)),        \
+                       static_cast<int64_t>(result), ElapsedNanos(start));     \
+            return result;                                                     \
+        }                                                                      \
+        return Dispatch##name(ARGS_MAP(ARG_NAME, __VA_ARGS__));                \
+    }                                                                          \
+                                                                               \
+    name##Guard::name##Guard(GlitchScope scope) : scope_(scope) {              \
+        if (scope_ == GlitchScope::Thread) {                                   \
+            prev_hook_ = std::exchange(name##Impl, this);                      \
+        } else {                                                               \
+            prev_hook_ = name##GlobalImpl.exchange(this);                      \
+        }                                                                      \
     }                                                                          \
                                                                                \
     name##Guard::~name##Guard() {                                              \
-        name##Impl = prev_hook_;                                               \
+        if (scope_ == GlitchScope::Thread) {                                   \
+            name##Impl = prev_hook_;                                           \
+        } else {                                                               \
+            name##GlobalImpl.store(prev_hook_, std::memory_order_release);     \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    ret name##Guard::Next##name(ARGS_MAP(ARG_DECL, __VA_ARGS__)) {             \
+        if (prev_hook_ != nullptr) {                                           \
+            return prev_hook_->name(ARGS_MAP(ARG_NAME, __VA_ARGS__));          \
+        }                                                                      \
+        if (scope_ == GlitchScope::Thread) {                                   \
+            if (auto hook = name##GlobalImpl.load(std::memory_order_acquire)) {\
+                return hook->name(ARGS_MAP(ARG_NAME, __VA_ARGS__));            \
+            }                                                                  \
+        }                                                                      \
+        return Real##name(ARGS_MAP(ARG_NAME, __VA_ARGS__));                    \
     }
 
 #define GLITCH_INTERNALS
@@ -0,0 +1,239 @@
+#include <glitch-profile.hpp>
+
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <time.h>
+
+namespace {
+
+struct Preset {
+    std::string_view name;
+    GlitchProfile profile;
+};
+
+constexpr Preset kPresets[] = {
+    {"short-io", {.short_read = 0.5, .short_write = 0.5}},
+    {"eintr-storm", {.eintr = 0.2, .eintr_burst = 16}},
+    {"slow-io", {.delay_ns = 20'000, .jitter_ns = 100'000}},
+    {"fork-failures", {.fork_failure = 0.5}},
+    {"hostile",
+     {.short_read = 0.3,
+      .short_write = 0.3,
+      .eintr = 0.05,
+      .eintr_burst = 4,
+      .delay_ns = 1'000,
+      .jitter_ns = 10'000,
+      .fork_failure = 0.2}},
+};
+
+template <class T>
+bool ParseNumber(std::string_view str, T* value) {
+    const char* end = str.data() + str.size();
+    auto [ptr, ec] = std::from_chars(str.data(), end, *value);
+    return ec == std::errc{} && ptr == end;
+}
+
+bool ParseProbability(std::string_view str, double* value) {
+    return ParseNumber(str, value) && *value >= 0 && *value <= 1;
+}
+
+bool SetField(GlitchProfile* profile, std::string_view key,
+              std::string_view value) {
+    if (key == "seed") {
+        return ParseNumber(value, &profile->seed);
+    } else if (key == "short_read") {
+        return ParseProbability(value, &profile->short_read);
+    } else if (key == "short_write") {
+        return ParseProbability(value, &profile->short_write);
+    } else if (key == "eintr") {
+        return ParseProbability(value, &profile->eintr);
+    } else if (key == "eintr_burst") {
+        return ParseNumber(value, &profile->eintr_burst) &&
+               profile->eintr_burst > 0;
+    } else if (key == "delay_ns") {
+        return ParseNumber(value, &profile->delay_ns);
+    } else if (key == "jitter_ns") {
+        return ParseNumber(value, &profile->jitter_ns);
+    } else if (key == "fork_failure") {
+        return ParseProbability(value, &profile->fork_failure);
+    }
+    return false;
+}
+
+void SleepNanos(uint64_t nanos) {
+    constexpr uint64_t kNsInSec = 1'000'000'000;
+    timespec duration{
+        .tv_sec = static_cast<time_t>(nanos / kNsInSec),
+        .tv_nsec = static_cast<long>(nanos % kNsInSec),
+    };
+    nanosleep(&duration, nullptr);
+}
+
+}  // namespace
+
+std::optional<GlitchProfile> GlitchProfile::Parse(std::string_view spec) {
+    GlitchProfile profile;
+    bool first = true;
+    while (!spec.empty()) {
+        const size_t comma = spec.find(',');
+        const std::string_view item = spec.substr(0, comma);
+        spec.remove_prefix(comma == spec.npos ? spec.size() : comma + 1);
+
+        const size_t equals = item.find('=');
+        if (equals == item.npos) {
+            // Only the first item may name a preset
+            const Preset* preset = nullptr;
+            for (const Preset& candidate : kPresets) {
+                if (candidate.name == item) {
+                    preset = &candidate;
+                }
+            }
+            if (!first || preset == nullptr) {
+                return std::nullopt;
+            }
+            profile = preset->profile;
+        } else if (!SetField(&profile, item.substr(0, equals),
+                             item.substr(equals + 1))) {
+            return std::nullopt;
+        }
+        first = false;
+    }
+    return profile;
+}
+
+ProfileGlitches::ProfileGlitches(const GlitchProfile& profile,
+                                 GlitchScope scope)
+    : ReadGuard(scope),
+      ReadChkGuard(scope),
+      PReadGuard(scope),
+      PReadChkGuard(scope),
+      WriteGuard(scope),
+      PWriteGuard(scope),
+      ForkGuard(scope),
+      profile_(profile),
+      rng_(profile.seed) {
+    rng_.Warmup();
+}
+
+bool ProfileGlitches::Chance(double probability) {
+    if (probability <= 0) {
+        return false;
+    }
+    return std::generate_canonical<double, 32>(rng_) < probability;
+}
+
+bool ProfileGlitches::Interrupt(double short_probability, size_t* count,
+                                uint64_t* shortened) {
+    uint64_t nanos = 0;
+    bool interrupted = false;
+    {
+        std::lock_guard lock{mutex_};
+        if (profile_.delay_ns > 0 || profile_.jitter_ns > 0) {
+            nanos = profile_.delay_ns;
+            if (profile_.jitter_ns > 0) {
+                std::exponential_distribution<double> jitter{
+                    1.0 / static_cast<double>(profile_.jitter_ns)};
+                nanos += static_cast<uint64_t>(jitter(rng_));
+            }
+            ++stats_.delays;
+        }
+
+        if (pending_interrupts_ == 0 && Chance(profile_.eintr)) {
+            pending_interrupts_ = 1 + rng_() % profile_.eintr_burst;
+        }
+        if (pending_interrupts_ > 0) {
+            --pending_interrupts_;
+            ++stats_.interrupts;
+            interrupted = true;
+        } else if (*count > 1 && Chance(short_probability)) {
+            // Strictly less than requested, otherwise nothing was shortened
+            *count = rng_() % (*count - 1) + 1;
+            ++*shortened;
+        }
+    }
+
+    if (nanos > 0) {
+        SleepNanos(nanos);
+    }
+    if (interrupted) {
+        errno = EINTR;
+    }
+    return interrupted;
+}
+
+ssize_t ProfileGlitches::Read(int fd, void* buf, size_t count) {
+    if (Interrupt(profile_.short_read, &count, &stats_.short_reads)) {
+        return -1;
+    }
+    return NextRead(fd, buf, count);
+}
+
+ssize_t ProfileGlitches::ReadChk(int fd, void* buf, size_t count,
+                                 size_t buflen) {
+    if (Interrupt(profile_.short_read, &count, &stats_.short_reads)) {
+        return -1;
+    }
+    return NextReadChk(fd, buf, count, buflen);
+}
+
+ssize_t ProfileGlitches::PRead(int fd, void* buf, size_t count,
+                               off_t offset) {
+    if (Interrupt(profile_.short_read, &count, &stats_.short_reads)) {
+        return -1;
+    }
+    return NextPRead(fd, buf, count, offset);
+}
+
+ssize_t ProfileGlitches::PReadChk(int fd, void* buf, size_t count,
+                                  off_t offset, size_t buflen) {
+    if (Interrupt(profile_.short_read, &count, &stats_.short_reads)) {
+        return -1;
+    }
+    return NextPReadChk(fd, buf, count, offset, buflen);
+}
+
+ssize_t ProfileGlitches::Write(int fd, const void* buf, size_t count) {
+    if (Interrupt(profile_.short_write, &count, &stats_.short_writes)) {
+        return -1;
+    }
+    return NextWrite(fd, buf, count);
+}
+
+ssize_t ProfileGlitches::PWrite(int fd, const void* buf, size_t count,
+                                off_t offset) {
+    if (Interrupt(profile_.short_write, &count, &stats_.short_writes)) {
+        return -1;
+    }
+    return NextPWrite(fd, buf, count, offset);
+}
+
+pid_t ProfileGlitches::Fork() {
+    {
+        std::lock_guard lock{mutex_};
+        if (Chance(profile_.fork_failure)) {
+            ++stats_.fork_failures;
+            errno = EAGAIN;
+            return -1;
+        }
+    }
+    return NextFork();
+}
+
+bool InstallProfileFromEnv() {
+    const char* spec = std::getenv("GLITCH_PROFILE");
+    if (spec == nullptr || *spec == '\0') {
+        return false;
+    }
+    auto profile = GlitchProfile::Parse(spec);
+    if (!profile) {
+        std::cerr << "Malformed GLITCH_PROFILE: " << spec << std::endl;
+        std::abort();
+    }
+    // Never destroyed, so it stays installed while static objects die
+    static auto* glitches =
+        new ProfileGlitches{*profile, GlitchScope::Process};
+    return glitches != nullptr;
+}
@@ -0,0 +1,200 @@
+#include "record.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <pthread.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr const char* kCallNames[] = {
+#define XX(name, cname, ...) #cname,
+#define GLITCH_INTERNALS
+#include <glitch-calls.inc>
+#undef GLITCH_INTERNALS
+#undef XX
+};
+
+constexpr size_t kCalls = static_cast<size_t>(GlitchCall::Count);
+// Bucket i counts values in [2^i, 2^(i + 1)), zero goes to bucket 0
+constexpr size_t kBuckets = 48;
+constexpr size_t kRingSize = 512;
+
+struct Event {
+    GlitchCall call;
+    uint64_t requested;
+    int64_t result;
+    uint64_t nanos;
+};
+
+struct CallSummary {
+    uint64_t calls = 0;
+    uint64_t errors = 0;
+    uint64_t requested = 0;
+    uint64_t transferred = 0;
+    uint64_t nanos = 0;
+    std::array<uint64_t, kBuckets> sizes{};
+    std::array<uint64_t, kBuckets> latencies{};
+};
+
+size_t Bucket(uint64_t value) {
+    if (value == 0) {
+        return 0;
+    }
+    return std::min<size_t>(63 - __builtin_clzll(value), kBuckets - 1);
+}
+
+// Turned off by the reporter, so that its own output is not recorded
+std::atomic<bool> recording = true;
+
+// Threads fold their rings in here when they fill up and when they exit
+std::mutex summary_mutex;
+std::array<CallSummary, kCalls> summary;
+
+void Fold(const Event* events, size_t count) {
+    std::lock_guard lock{summary_mutex};
+    for (size_t i = 0; i < count; ++i) {
+        const Event& event = events[i];
+        CallSummary& entry = summary[static_cast<size_t>(event.call)];
+        ++entry.calls;
+        if (event.result == -1) {
+            ++entry.errors;
+        }
+        entry.nanos += event.nanos;
+        ++entry.latencies[Bucket(event.nanos)];
+        if (event.requested > 0) {
+            entry.requested += event.requested;
+            ++entry.sizes[Bucket(event.requested)];
+            if (event.result > 0) {
+                entry.transferred += static_cast<uint64_t>(event.result);
+            }
+        }
+    }
+}
+
+// Set once the ring of the thread is destroyed. Calls made by destructors
+// that run later are folded one by one.
+thread_local bool ring_destroyed = false;
+
+// Recording touches only thread-local memory, except for a locked fold every
+// kRingSize calls
+class Ring {
+  public:
+    ~Ring() {
+        Flush();
+        ring_destroyed = true;
+    }
+
+    void Push(const Event& event) {
+        events_[size_] = event;
+        if (++size_ == kRingSize) {
+            Flush();
+        }
+    }
+
+    void Flush() {
+        Fold(events_.data(), size_);
+        size_ = 0;
+    }
+
+    void Clear() {
+        size_ = 0;
+    }
+
+  private:
+    std::array<Event, kRingSize> events_;
+    size_t size_ = 0;
+};
+
+thread_local Ring ring;
+
+void PrintHistogram(const char* title,
+                    const std::array<uint64_t, kBuckets>& histogram) {
+    std::fprintf(stderr, "  %-10s", title);
+    for (size_t i = 0; i < kBuckets; ++i) {
+        if (histogram[i] != 0) {
+            std::fprintf(stderr, " <2^%zu:%lu", i + 1,
+                         static_cast<unsigned long>(histogram[i]));
+        }
+    }
+    std::fprintf(stderr, "\n");
+}
+
+// The child starts with empty statistics, the parent reports what it did
+// before the fork. Another thread of the parent may have held the mutex at
+// the moment of the fork, so the child gets a new one.
+void ResetAfterFork() {
+    new (&summary_mutex) std::mutex;
+    if (!ring_destroyed) {
+        ring.Clear();
+    }
+    summary = {};
+}
+
+bool StartRecording() {
+    const char* value = std::getenv("GLITCH_RECORD");
+    if (value == nullptr || *value == '\0') {
+        return false;
+    }
+    pthread_atfork(nullptr, nullptr, ResetAfterFork);
+    return true;
+}
+
+// Destroyed after the thread-local ring of the main thread is flushed.
+// Printing goes through the wrapped write, so recording is turned off first
+// and the summary is printed from a copy without holding the mutex.
+struct Reporter {
+    ~Reporter() {
+        if (!kGlitchRecording) {
+            return;
+        }
+        recording.store(false);
+        std::array<CallSummary, kCalls> snapshot;
+        {
+            std::lock_guard lock{summary_mutex};
+            snapshot = summary;
+        }
+        std::fprintf(stderr, "glitch record of pid %d\n", getpid());
+        std::fprintf(stderr, "%-12s %10s %8s %14s %14s %12s\n", "call",
+                     "calls", "errors", "requested", "transferred",
+                     "mean ns");
+        for (size_t i = 0; i < kCalls; ++i) {
+            const CallSummary& entry = snapshot[i];
+            if (entry.calls == 0) {
+                continue;
+            }
+            std::fprintf(stderr, "%-12s %10lu %8lu %14lu %14lu %12lu\n",
+                         kCallNames[i], static_cast<unsigned long>(entry.calls),
+                         static_cast<unsigned long>(entry.errors),
+                         static_cast<unsigned long>(entry.requested),
+                         static_cast<unsigned long>(entry.transferred),
+                         static_cast<unsigned long>(entry.nanos / entry.calls));
+            if (entry.requested > 0) {
+                PrintHistogram("bytes", entry.sizes);
+            }
+            PrintHistogram("ns", entry.latencies);
+        }
+    }
+} reporter;
+
+}  // namespace
+
+const bool kGlitchRecording = StartRecording();
+
+void RecordCall(GlitchCall call, uint64_t requested, int64_t result,
+                uint64_t nanos) {
+    if (!recording.load(std::memory_order_relaxed)) {
+        return;
+    }
+    const Event event{call, requested, result, nanos};
+    if (ring_destroyed) {
+        Fold(&event, 1);
+        return;
+    }
+    ring.Push(event);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glitch.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// Recording of every wrapped call, enabled by setting GLITCH_RECORD in the
+// environment. Calls are buffered in a per-thread ring and a summary with
+// byte counts and log2 histograms of request sizes and latencies is printed
+// to stderr at exit.
+
+#define XX(name, ...) name,
+enum class GlitchCall {
+#define GLITCH_INTERNALS
+#include <glitch-calls.inc>
+#undef GLITCH_INTERNALS
+    Count,
+};
+#undef XX
+
+// Set once before main, checked by every wrapper
+extern const bool kGlitchRecording;
+
+void RecordCall(GlitchCall call, uint64_t requested, int64_t result,
+                uint64_t nanos);
+
+// Bytes the call asked for, zero for calls that don't transfer data
+template <class... Rest>
+uint64_t RequestedBytes(int, const void*, size_t count, Rest...) {
+    return count;
+}
+
+inline uint64_t RequestedBytes(...) {
+    return 0;
+}
@@ -0,0 +1,241 @@
+#include <glitch-profile.hpp>
+#include <glitch.hpp>
+
+#include <internal-assert.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+TEST_CASE("ParsePresets") {
+    auto empty = GlitchProfile::Parse("");
+    REQUIRE(empty.has_value());
+    CHECK(empty->seed == 42);
+    CHECK(empty->short_read == 0);
+    CHECK(empty->eintr_burst == 1);
+
+    auto storm = GlitchProfile::Parse("eintr-storm");
+    REQUIRE(storm.has_value());
+    CHECK(storm->eintr == 0.2);
+    CHECK(storm->eintr_burst == 16);
+    CHECK(storm->short_read == 0);
+
+    auto hostile = GlitchProfile::Parse("hostile");
+    REQUIRE(hostile.has_value());
+    CHECK(hostile->short_write == 0.3);
+    CHECK(hostile->jitter_ns == 10'000);
+    CHECK(hostile->fork_failure == 0.2);
+}
+
+TEST_CASE("ParseOverrides") {
+    auto profile =
+        GlitchProfile::Parse("slow-io,seed=7,delay_ns=5,short_read=1");
+    REQUIRE(profile.has_value());
+    CHECK(profile->seed == 7);
+    CHECK(profile->delay_ns == 5);
+    CHECK(profile->jitter_ns == 100'000);
+    CHECK(profile->short_read == 1);
+
+    auto fields = GlitchProfile::Parse(
+        "short_write=0.25,eintr=0.5,eintr_burst=3,fork_failure=0");
+    REQUIRE(fields.has_value());
+    CHECK(fields->short_write == 0.25);
+    CHECK(fields->eintr == 0.5);
+    CHECK(fields->eintr_burst == 3);
+    CHECK(fields->fork_failure == 0);
+}
+
+TEST_CASE("ParseRejects") {
+    // Unknown or misplaced presets, malformed items and values out of range
+    const char* specs[] = {
+        "unknown",       "seed=7,short-io", "short-io,hostile",
+        ",",             "seed",            "seed=",
+        "seed=x",        "seed=-1",         "nope=1",
+        "short_read=1.5", "eintr=-0.1",     "eintr_burst=0",
+        "delay_ns=1e3",  "short-io,seed=7,jitter_ns",
+    };
+    for (const char* spec : specs) {
+        INFO(spec);
+        CHECK_FALSE(GlitchProfile::Parse(spec).has_value());
+    }
+}
+
+struct CountReads final : ReadGuard {
+    using ReadGuard::ReadGuard;
+
+    ssize_t Read(int fd, void* buf, size_t count) override {
+        ++calls;
+        last_count = count;
+        return NextRead(fd, buf, count);
+    }
+
+    size_t calls = 0;
+    size_t last_count = 0;
+};
+
+TEST_CASE("ProfileChainsHooks") {
+    int fd = open("/dev/zero", O_RDONLY | O_CLOEXEC);
+    INTERNAL_ASSERT(fd != -1);
+    char buf[64];
+
+    // The thread guard has no previous thread hook, so it passes the calls
+    // on to the process one
+    CountReads counter{GlitchScope::Process};
+    {
+        ProfileGlitches glitches{*GlitchProfile::Parse("short_read=1")};
+        auto ret = read(fd, buf, sizeof(buf));
+        CHECK(ret > 0);
+        CHECK(ret < static_cast<ssize_t>(sizeof(buf)));
+        CHECK(counter.calls == 1);
+        CHECK(counter.last_count == static_cast<size_t>(ret));
+        CHECK(glitches.GetStats().short_reads == 1);
+    }
+    {
+        ProfileGlitches glitches{*GlitchProfile::Parse("eintr=1")};
+        errno = 0;
+        auto ret = read(fd, buf, sizeof(buf));
+        CHECK(ret == -1);
+        CHECK(errno == EINTR);
+        CHECK(counter.calls == 1);
+        CHECK(glitches.GetStats().interrupts == 1);
+    }
+    CHECK(read(fd, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(counter.calls == 2);
+    close(fd);
+}
+
+TEST_CASE("ProfileSharedByThreads") {
+    constexpr size_t kThreads = 4;
+    constexpr size_t kReads = 10'000;
+
+    int fd = open("/dev/zero", O_RDONLY | O_CLOEXEC);
+    INTERNAL_ASSERT(fd != -1);
+
+    ProfileGlitches glitches{*GlitchProfile::Parse("short_read=1"),
+                             GlitchScope::Process};
+    // Catch assertions are not thread-safe, failures are counted instead
+    std::atomic<size_t> failed = 0;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < kThreads; ++i) {
+        threads.emplace_back([fd, &failed] {
+            char buf[64];
+            for (size_t j = 0; j < kReads; ++j) {
+                auto ret = read(fd, buf, sizeof(buf));
+                if (ret <= 0 || ret >= static_cast<ssize_t>(sizeof(buf))) {
+                    ++failed;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK(failed == 0);
+    CHECK(glitches.GetStats().short_reads == kThreads * kReads);
+    close(fd);
+}
+
+// Appends its tag to the log and passes the call on
+struct TraceReads final : ReadGuard {
+    TraceReads(char tag, std::string* log,
+               GlitchScope scope = GlitchScope::Thread)
+        : ReadGuard{scope}, tag{tag}, log{log} {
+    }
+
+    ssize_t Read(int fd, void* buf, size_t count) override {
+        *log += tag;
+        return NextRead(fd, buf, count);
+    }
+
+    char tag;
+    std::string* log;
+};
+
+struct FailReads final : ReadGuard {
+    ssize_t Read(int, void*, size_t) override {
+        ++calls;
+        errno = EIO;
+        return -1;
+    }
+
+    size_t calls = 0;
+};
+
+// Number of full reads out of kConcurrentReads made by a new thread
+constexpr size_t kConcurrentReads = 1'000;
+
+static size_t ConcurrentReads(int fd) {
+    size_t succeeded = 0;
+    std::thread reader{[fd, &succeeded] {
+        char buf[64];
+        for (size_t i = 0; i < kConcurrentReads; ++i) {
+            if (read(fd, buf, sizeof(buf)) == sizeof(buf)) {
+                ++succeeded;
+            }
+        }
+    }};
+    reader.join();
+    return succeeded;
+}
+
+TEST_CASE("ThreadGuardStaysInThread") {
+    int fd = open("/dev/zero", O_RDONLY | O_CLOEXEC);
+    INTERNAL_ASSERT(fd != -1);
+    char buf[64];
+
+    FailReads fail;
+    errno = 0;
+    CHECK(read(fd, buf, sizeof(buf)) == -1);
+    CHECK(errno == EIO);
+
+    // Other threads reach the real read...
+    CHECK(ConcurrentReads(fd) == kConcurrentReads);
+    {
+        // ...or the process hook, but never the thread guard
+        CountReads counter{GlitchScope::Process};
+        CHECK(ConcurrentReads(fd) == kConcurrentReads);
+        CHECK(counter.calls == kConcurrentReads);
+        CHECK(read(fd, buf, sizeof(buf)) == -1);
+        CHECK(counter.calls == kConcurrentReads);
+    }
+    CHECK(fail.calls == 2);
+    close(fd);
+}
+
+TEST_CASE("ThreadGuardsOverProcessGuard") {
+    int fd = open("/dev/zero", O_RDONLY | O_CLOEXEC);
+    INTERNAL_ASSERT(fd != -1);
+    char buf[64];
+    std::string log;
+
+    TraceReads process{'p', &log, GlitchScope::Process};
+    {
+        TraceReads outer{'o', &log};
+        {
+            // The innermost thread guard goes first, then the guards below it
+            // on this thread, then the process guard, then the real read
+            TraceReads inner{'i', &log};
+            CHECK(read(fd, buf, sizeof(buf)) == sizeof(buf));
+            CHECK(log == "iop");
+        }
+        log.clear();
+        CHECK(read(fd, buf, sizeof(buf)) == sizeof(buf));
+        CHECK(log == "op");
+
+        // A process guard installed later is still below the thread ones
+        TraceReads later{'l', &log, GlitchScope::Process};
+        log.clear();
+        CHECK(read(fd, buf, sizeof(buf)) == sizeof(buf));
+        CHECK(log == "olp");
+    }
+    log.clear();
+    CHECK(read(fd, buf, sizeof(buf)) == sizeof(buf));
+    CHECK(log == "p");
+    close(fd);
+}
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
 
 extern int Errno;
 extern char** Environ;
@@ -11,12 +14,29 @@ int Open(const char* filename, int flags, mode_t mode);
 int OpenAt(int dirfd, const char* filename, int flags, mode_t mode);
 
 int Close(int fd);
+int Pipe2(int* fds, int flags);
 
 [[noreturn]] void Exit(int status);
 
 ssize_t Write(int fd, const char* buf, size_t count);
 ssize_t Read(int fd, char* buf, size_t count);
 
+ssize_t ReadV(int fd, const struct iovec* iov, int iovcnt);
+ssize_t WriteV(int fd, const struct iovec* iov, int iovcnt);
+// offset -1 means the current file position, flags are RWF_*
+ssize_t PReadV2(int fd, const struct iovec* iov, int iovcnt, off_t offset,
+                int flags);
+ssize_t PWriteV2(int fd, const struct iovec* iov, int iovcnt, off_t offset,
+                 int flags);
+
+// Copy inside the kernel, without passing the data through user space
+ssize_t SendFile(int out_fd, int in_fd, off_t* offset, size_t count);
+ssize_t Splice(int fd_in, off_t* off_in, int fd_out, off_t* off_out,
+               size_t len, unsigned flags);
+ssize_t Tee(int fd_in, int fd_out, size_t len, unsigned flags);
+ssize_t CopyFileRange(int fd_in, off_t* off_in, int fd_out, off_t* off_out,
+                      size_t len, unsigned flags);
+
 void* MMap(void* addr, size_t length, int prot, int flags, int fd,
            off_t offset);
 void MUnMap(void* addr, size_t length);
@@ -26,3 +46,20 @@ void* MReMap(void* old_addr, size_t old_size, size_t new_size, int flags,
 int MAdvise(void* addr, size_t length, int advice);
 
 int ExecVE(const char* filename, const char** argv, const char** envp);
+
+struct io_uring_params;
+
+int IoUringSetup(unsigned entries, struct io_uring_params* params);
+int IoUringEnter(int fd, unsigned to_submit, unsigned min_complete,
+                 unsigned flags, const void* sig, size_t sigsz);
+
+// Remembers the auxiliary vector, which follows the environment on the
+// initial stack, and finds the vDSO in it. Called by the entry point.
+void InitAuxv(const uintptr_t* auxv);
+// Value of the auxiliary vector entry of the given type (AT_*), 0 if absent
+uintptr_t GetAuxVal(uintptr_t type);
+
+// Served by the vDSO without entering the kernel when it provides them,
+// otherwise by the syscalls
+int ClockGetTime(clockid_t clock, struct timespec* ts);
+int GetCpu(unsigned* cpu, unsigned* node);
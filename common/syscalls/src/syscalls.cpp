@@ -1,10 +1,14 @@
 #include "syscall_impl.hpp"
+#include "trace.hpp"
+#include "vdso.hpp"
 
 #include <macros.hpp>
 #include <syscalls.hpp>
 
+#include <elf.h>
 #include <fcntl.h>
 #include <sys/syscall.h>
+#include <unistd.h>
 
 int Errno = 0;
 
@@ -14,8 +18,7 @@ int Errno = 0;
 #define DEFINE_SYSCALL(ret, cpp_name, name, ...)                               \
     ret cpp_name(ARGS_MAP(ARG_DECL, __VA_ARGS__)) {                            \
         return FromSysret(                                                     \
-            InternalSyscallImpl(SYS_##name,                                    \
-                                ARGS_MAP(TO_SYSCALL_ARG, __VA_ARGS__)),        \
+            Syscall(SYS_##name, #name, ARGS_MAP(TO_SYSCALL_ARG, __VA_ARGS__)), \
             To<ret>{});                                                        \
     }
 
@@ -23,6 +26,20 @@ int Errno = 0;
 // unnecessary
 namespace {
 
+// The single entry into the kernel, records the call if tracing is enabled
+template <class... Args>
+int64_t Syscall(int64_t sysnum, [[maybe_unused]] const char* name,
+                Args... args) {
+#ifdef SYSCALLS_TRACE
+    const uint64_t start = ReadCycleCounter();
+    const int64_t result = InternalSyscallImpl(sysnum, args...);
+    TraceRecord(sysnum, name, result, ReadCycleCounter() - start);
+    return result;
+#else
+    return InternalSyscallImpl(sysnum, args...);
+#endif
+}
+
 template <class T>
 int64_t ToSyscallArg(T* arg) {
     return reinterpret_cast<int64_t>(arg);
@@ -51,6 +68,17 @@ T* FromSysret(int64_t value, To<T*>) {
     return reinterpret_cast<T*>(FromSysret(value, To<int64_t>{}));
 }
 
+const uintptr_t* auxv = nullptr;
+
+// vDSO functions return the result of the syscall as is: -errno on failure.
+// The kernel declares __vdso_clock_gettime as returning int and
+// __vdso_getcpu as returning long.
+using ClockGetTimeFn = int (*)(clockid_t, struct timespec*);
+using GetCpuFn = int64_t (*)(unsigned*, unsigned*, void*);
+
+ClockGetTimeFn vdso_clock_gettime = nullptr;
+GetCpuFn vdso_getcpu = nullptr;
+
 }  // namespace
 
 // Arm doesn't provide 'open' syscall =(
@@ -62,8 +90,12 @@ DEFINE_SYSCALL(int, OpenAt, openat, int, dirfd, const char*, filename, int,
                flags, mode_t, mode)
 
 DEFINE_SYSCALL(int, Close, close, int, fd)
+DEFINE_SYSCALL(int, Pipe2, pipe2, int*, fds, int, flags)
 
 void Exit(int status) {
+#ifdef SYSCALLS_TRACE
+    TraceDump(STDERR_FILENO);
+#endif
     InternalSyscallImpl(SYS_exit, ToSyscallArg(status));
     Unreachable();
 }
@@ -71,6 +103,41 @@ void Exit(int status) {
 DEFINE_SYSCALL(ssize_t, Write, write, int, fd, const char*, buf, size_t, count)
 DEFINE_SYSCALL(ssize_t, Read, read, int, fd, char*, buf, size_t, count)
 
+DEFINE_SYSCALL(ssize_t, ReadV, readv, int, fd, const struct iovec*, iov, int,
+               iovcnt)
+DEFINE_SYSCALL(ssize_t, WriteV, writev, int, fd, const struct iovec*, iov, int,
+               iovcnt)
+
+// The offset is split in two registers for 32-bit targets, the high half is
+// ignored on 64-bit ones
+ssize_t PReadV2(int fd, const struct iovec* iov, int iovcnt, off_t offset,
+                int flags) {
+    return FromSysret(Syscall(SYS_preadv2, "preadv2", ToSyscallArg(fd),
+                              ToSyscallArg(iov), ToSyscallArg(iovcnt),
+                              ToSyscallArg(offset), int64_t{0},
+                              ToSyscallArg(flags)),
+                      To<ssize_t>{});
+}
+
+ssize_t PWriteV2(int fd, const struct iovec* iov, int iovcnt, off_t offset,
+                 int flags) {
+    return FromSysret(Syscall(SYS_pwritev2, "pwritev2", ToSyscallArg(fd),
+                              ToSyscallArg(iov), ToSyscallArg(iovcnt),
+                              ToSyscallArg(offset), int64_t{0},
+                              ToSyscallArg(flags)),
+                      To<ssize_t>{});
+}
+
+DEFINE_SYSCALL(ssize_t, SendFile, sendfile, int, out_fd, int, in_fd, off_t*,
+               offset, size_t, count)
+DEFINE_SYSCALL(ssize_t, Splice, splice, int, fd_in, off_t*, off_in, int,
+               fd_out, off_t*, off_out, size_t, len, unsigned, flags)
+DEFINE_SYSCALL(ssize_t, Tee, tee, int, fd_in, int, fd_out, size_t, len,
+               unsigned, flags)
+DEFINE_SYSCALL(ssize_t, CopyFileRange, copy_file_range, int, fd_in, off_t*,
+               off_in, int, fd_out, off_t*, off_out, size_t, len, unsigned,
+               flags)
+
 DEFINE_SYSCALL(void*, MMap, mmap, void*, addr, size_t, length, int, prot, int,
                flags, int, fd, off_t, offset)
 DEFINE_SYSCALL(void, MUnMap, munmap, void*, addr, size_t, length)
@@ -81,3 +148,50 @@ DEFINE_SYSCALL(int, MAdvise, madvise, void*, addr, size_t, length, int, advice)
 
 DEFINE_SYSCALL(int, ExecVE, execve, const char*, filename, const char**, argv,
                const char**, envp)
+
+DEFINE_SYSCALL(int, IoUringSetup, io_uring_setup, unsigned, entries,
+               struct io_uring_params*, params)
+DEFINE_SYSCALL(int, IoUringEnter, io_uring_enter, int, fd, unsigned,
+               to_submit, unsigned, min_complete, unsigned, flags,
+               const void*, sig, size_t, sigsz)
+
+void InitAuxv(const uintptr_t* vector) {
+    auxv = vector;
+    if (const uintptr_t base = GetAuxVal(AT_SYSINFO_EHDR); base != 0) {
+        const VdsoSymbols symbols = FindVdsoSymbols(base);
+        vdso_clock_gettime =
+            reinterpret_cast<ClockGetTimeFn>(symbols.clock_gettime);
+        vdso_getcpu = reinterpret_cast<GetCpuFn>(symbols.getcpu);
+    }
+}
+
+uintptr_t GetAuxVal(uintptr_t type) {
+    if (auxv == nullptr) {
+        return 0;
+    }
+    for (const uintptr_t* entry = auxv; entry[0] != AT_NULL; entry += 2) {
+        if (entry[0] == type) {
+            return entry[1];
+        }
+    }
+    return 0;
+}
+
+int ClockGetTime(clockid_t clock, struct timespec* ts) {
+    if (vdso_clock_gettime != nullptr) {
+        // Sign-extended, so that -errno stays in the error range
+        return FromSysret(int64_t{vdso_clock_gettime(clock, ts)}, To<int>{});
+    }
+    return FromSysret(Syscall(SYS_clock_gettime, "clock_gettime",
+                              ToSyscallArg(clock), ToSyscallArg(ts)),
+                      To<int>{});
+}
+
+int GetCpu(unsigned* cpu, unsigned* node) {
+    if (vdso_getcpu != nullptr) {
+        return FromSysret(vdso_getcpu(cpu, node, nullptr), To<int>{});
+    }
+    return FromSysret(Syscall(SYS_getcpu, "getcpu", ToSyscallArg(cpu),
+                              ToSyscallArg(node), int64_t{0}),
+                      To<int>{});
+}
@@ -0,0 +1,128 @@
+#include "trace.hpp"
+#include "syscall_impl.hpp"
+
+#include <cstddef>
+#include <sys/syscall.h>
+
+namespace {
+
+// Above the largest syscall number of both architectures
+constexpr int64_t kMaxSyscalls = 512;
+// Bucket i counts latencies in [2^i, 2^(i + 1)), zero goes to bucket 0
+constexpr int kBuckets = 48;
+
+struct SyscallStats {
+    const char* name;
+    uint64_t calls;
+    uint64_t errors;
+    uint64_t ticks;
+    uint64_t histogram[kBuckets];
+};
+
+// Zero-initialized, so it costs nothing until touched. Updated with relaxed
+// atomics: no locks and no lost updates if the address space is shared.
+SyscallStats stats[kMaxSyscalls];
+
+int Bucket(uint64_t ticks) {
+    if (ticks == 0) {
+        return 0;
+    }
+    const int bucket = 63 - __builtin_clzll(ticks);
+    return bucket < kBuckets ? bucket : kBuckets - 1;
+}
+
+// Collects a line and writes it with a single raw syscall, which isn't
+// recorded itself
+class Line {
+  public:
+    Line& operator<<(const char* str) {
+        while (*str != '\0' && size_ < sizeof(buffer_)) {
+            buffer_[size_++] = *str++;
+        }
+        return *this;
+    }
+
+    Line& operator<<(uint64_t value) {
+        char digits[20];
+        size_t count = 0;
+        do {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (count > 0 && size_ < sizeof(buffer_)) {
+            buffer_[size_++] = digits[--count];
+        }
+        return *this;
+    }
+
+    // Pads with spaces up to the column
+    Line& Column(size_t column) {
+        while (size_ < column && size_ < sizeof(buffer_)) {
+            buffer_[size_++] = ' ';
+        }
+        return *this;
+    }
+
+    void WriteTo(int fd) {
+        *this << "\n";
+        InternalSyscallImpl(SYS_write, int64_t{fd},
+                            reinterpret_cast<int64_t>(buffer_),
+                            static_cast<int64_t>(size_));
+    }
+
+  private:
+    char buffer_[128];
+    size_t size_ = 0;
+};
+
+}  // namespace
+
+void TraceRecord(int64_t sysnum, const char* name, int64_t result,
+                 uint64_t ticks) {
+    if (sysnum < 0 || sysnum >= kMaxSyscalls) {
+        return;
+    }
+    SyscallStats& entry = stats[sysnum];
+    __atomic_store_n(&entry.name, name, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&entry.calls, 1, __ATOMIC_RELAXED);
+    if (result > -4096 && result < 0) {
+        __atomic_fetch_add(&entry.errors, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&entry.ticks, ticks, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&entry.histogram[Bucket(ticks)], 1, __ATOMIC_RELAXED);
+}
+
+void TraceDump(int fd) {
+    Line header;
+    header << "syscall";
+    header.Column(20) << "calls";
+    header.Column(32) << "errors";
+    header.Column(44) << "mean ticks";
+    header.WriteTo(fd);
+
+    for (const SyscallStats& entry : stats) {
+        const uint64_t calls = __atomic_load_n(&entry.calls, __ATOMIC_RELAXED);
+        if (calls == 0) {
+            continue;
+        }
+        Line line;
+        line << entry.name;
+        line.Column(20) << calls;
+        line.Column(32) << __atomic_load_n(&entry.errors, __ATOMIC_RELAXED);
+        line.Column(44)
+            << __atomic_load_n(&entry.ticks, __ATOMIC_RELAXED) / calls;
+        line.WriteTo(fd);
+
+        for (int bucket = 0; bucket < kBuckets; ++bucket) {
+            const uint64_t count =
+                __atomic_load_n(&entry.histogram[bucket], __ATOMIC_RELAXED);
+            if (count == 0) {
+                continue;
+            }
+            Line row;
+            row.Column(4) << "< 2^" << static_cast<uint64_t>(bucket + 1);
+            row.Column(20) << count;
+            row.WriteTo(fd);
+        }
+    }
+}
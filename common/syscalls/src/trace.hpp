@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+// Syscall statistics collected when the library is built with
+// SYSCALLS_TRACE: calls, failures and a log2 histogram of the latency in
+// ticks of the cycle counter, per syscall number.
+
+// rdtsc on x86-64, cntvct_el0 on aarch64
+inline uint64_t ReadCycleCounter() {
+#if defined(__x86_64__)
+    uint32_t low;
+    uint32_t high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return (static_cast<uint64_t>(high) << 32) | low;
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("isb\n\tmrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+#error "Unknown architecture"
+#endif
+}
+
+// name must be a string literal
+void TraceRecord(int64_t sysnum, const char* name, int64_t result,
+                 uint64_t ticks);
+
+// Writes a table of every syscall made so far
+void TraceDump(int fd);
@@ -0,0 +1,123 @@
+#include "vdso.hpp"
+
+#include <cstddef>
+#include <elf.h>
+
+namespace {
+
+// Names differ between architectures, arm64 has no getcpu in the vDSO
+#if defined(__x86_64__)
+constexpr const char* kClockGetTimeName = "__vdso_clock_gettime";
+constexpr const char* kGetCpuName = "__vdso_getcpu";
+#elif defined(__aarch64__)
+constexpr const char* kClockGetTimeName = "__kernel_clock_gettime";
+constexpr const char* kGetCpuName = nullptr;
+#endif
+
+bool Equal(const char* lhs, const char* rhs) {
+    while (*lhs != '\0' && *lhs == *rhs) {
+        ++lhs, ++rhs;
+    }
+    return *lhs == *rhs;
+}
+
+// DT_GNU_HASH doesn't store the number of symbols: it's one past the last
+// symbol of the longest chain
+size_t GnuHashSymbolCount(const Elf64_Word* table) {
+    const Elf64_Word buckets_count = table[0];
+    const Elf64_Word first_symbol = table[1];
+    const Elf64_Word bloom_size = table[2];
+    const Elf64_Word* buckets = table + 4 + bloom_size * 2;
+    const Elf64_Word* chains = buckets + buckets_count;
+
+    Elf64_Word last = 0;
+    for (Elf64_Word i = 0; i < buckets_count; ++i) {
+        last = buckets[i] > last ? buckets[i] : last;
+    }
+    if (last < first_symbol) {
+        return first_symbol;
+    }
+    // The lowest bit marks the end of a chain
+    while ((chains[last - first_symbol] & 1) == 0) {
+        ++last;
+    }
+    return last + 1;
+}
+
+}  // namespace
+
+VdsoSymbols FindVdsoSymbols(uintptr_t base) {
+    VdsoSymbols symbols;
+    const auto* header = reinterpret_cast<const Elf64_Ehdr*>(base);
+    const auto* segments =
+        reinterpret_cast<const Elf64_Phdr*>(base + header->e_phoff);
+
+    // Addresses in the image are relative to the first loadable segment
+    uintptr_t bias = 0;
+    bool has_load = false;
+    const Elf64_Dyn* dynamic = nullptr;
+    for (size_t i = 0; i < header->e_phnum; ++i) {
+        const Elf64_Phdr& segment = segments[i];
+        if (segment.p_type == PT_LOAD && !has_load) {
+            bias = base + segment.p_offset - segment.p_vaddr;
+            has_load = true;
+        } else if (segment.p_type == PT_DYNAMIC) {
+            dynamic = reinterpret_cast<const Elf64_Dyn*>(base +
+                                                         segment.p_offset);
+        }
+    }
+    if (!has_load || dynamic == nullptr) {
+        return symbols;
+    }
+
+    const Elf64_Sym* symbol_table = nullptr;
+    const char* string_table = nullptr;
+    const Elf64_Word* hash = nullptr;
+    const Elf64_Word* gnu_hash = nullptr;
+    for (const Elf64_Dyn* entry = dynamic; entry->d_tag != DT_NULL; ++entry) {
+        const uintptr_t address = bias + entry->d_un.d_ptr;
+        switch (entry->d_tag) {
+        case DT_SYMTAB:
+            symbol_table = reinterpret_cast<const Elf64_Sym*>(address);
+            break;
+        case DT_STRTAB:
+            string_table = reinterpret_cast<const char*>(address);
+            break;
+        case DT_HASH:
+            hash = reinterpret_cast<const Elf64_Word*>(address);
+            break;
+        case DT_GNU_HASH:
+            gnu_hash = reinterpret_cast<const Elf64_Word*>(address);
+            break;
+        default:
+            break;
+        }
+    }
+    if (symbol_table == nullptr || string_table == nullptr ||
+        (hash == nullptr && gnu_hash == nullptr)) {
+        return symbols;
+    }
+
+    // Few symbols, a linear scan is enough. DT_HASH stores their number
+    // right after the number of buckets.
+    const size_t count =
+        hash != nullptr ? hash[1] : GnuHashSymbolCount(gnu_hash);
+    for (size_t i = 0; i < count; ++i) {
+        const Elf64_Sym& symbol = symbol_table[i];
+        const auto binding = ELF64_ST_BIND(symbol.st_info);
+        if (ELF64_ST_TYPE(symbol.st_info) != STT_FUNC ||
+            symbol.st_shndx == SHN_UNDEF ||
+            (binding != STB_GLOBAL && binding != STB_WEAK)) {
+            continue;
+        }
+
+        const char* name = string_table + symbol.st_name;
+        auto* address = reinterpret_cast<void*>(bias + symbol.st_value);
+        if (Equal(name, kClockGetTimeName)) {
+            symbols.clock_gettime = address;
+        } else if (kGetCpuName != nullptr && Equal(name, kGetCpuName)) {
+            symbols.getcpu = address;
+        }
+    }
+    return symbols;
+}
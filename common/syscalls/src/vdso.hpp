@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// Entry points of the vDSO, null when it doesn't provide them
+struct VdsoSymbols {
+    void* clock_gettime = nullptr;
+    void* getcpu = nullptr;
+};
+
+// Looks the symbols up in the dynamic symbol table of the vDSO image mapped
+// at base (AT_SYSINFO_EHDR)
+VdsoSymbols FindVdsoSymbols(uintptr_t base);
@@ -0,0 +1,89 @@
+#include "src/syscall_impl.hpp"
+
+#include <assert.hpp>
+#include <syscalls.hpp>
+
+#include <cerrno>
+#include <cstdint>
+#include <elf.h>
+#include <sys/syscall.h>
+#include <time.h>
+
+namespace {
+
+int64_t ToNanos(const timespec& ts) {
+    return ts.tv_sec * 1'000'000'000ll + ts.tv_nsec;
+}
+
+// Bypasses the vDSO
+int64_t RawClockGetTime(clockid_t clock) {
+    timespec ts{};
+    ASSERT(InternalSyscallImpl(SYS_clock_gettime, int64_t{clock},
+                               reinterpret_cast<int64_t>(&ts)) == 0);
+    return ToNanos(ts);
+}
+
+int64_t ClockNanos(clockid_t clock) {
+    timespec ts{};
+    ASSERT(ClockGetTime(clock, &ts) == 0);
+    return ToNanos(ts);
+}
+
+}  // namespace
+
+void TestClockGetTime() {
+    int64_t prev = ClockNanos(CLOCK_MONOTONIC);
+    for (int i = 0; i < 1000; ++i) {
+        const int64_t raw = RawClockGetTime(CLOCK_MONOTONIC);
+        const int64_t now = ClockNanos(CLOCK_MONOTONIC);
+        // Same clock as the kernel's, and it never goes back
+        ASSERT(prev <= raw);
+        ASSERT(raw <= now);
+        prev = now;
+    }
+
+    // Realtime may be stepped, but not within a few calls
+    const int64_t realtime = ClockNanos(CLOCK_REALTIME);
+    const int64_t raw = RawClockGetTime(CLOCK_REALTIME);
+    ASSERT(raw - realtime < 1'000'000'000ll);
+
+    timespec ts{};
+    ASSERT(ClockGetTime(-1, &ts) == -1);
+    ASSERT(Errno == EINVAL);
+}
+
+void TestGetAuxVal() {
+    ASSERT(GetAuxVal(AT_PAGESZ) == 4096);
+    ASSERT(GetAuxVal(AT_SYSINFO_EHDR) != 0);
+    // Not in the vector
+    ASSERT(GetAuxVal(~uintptr_t{0}) == 0);
+}
+
+void TestGetCpu() {
+    unsigned cpu = ~0u;
+    unsigned node = ~0u;
+    ASSERT(GetCpu(&cpu, &node) == 0);
+    ASSERT(node != ~0u);
+
+    // The thread runs on one of the processors it is allowed to run on
+    uint64_t mask[16] = {};
+    const int64_t bytes =
+        InternalSyscallImpl(SYS_sched_getaffinity, int64_t{0},
+                            int64_t{sizeof(mask)},
+                            reinterpret_cast<int64_t>(mask));
+    ASSERT(bytes > 0);
+    const auto nprocs = static_cast<unsigned>(bytes) * 8;
+    ASSERT(cpu < nprocs);
+    ASSERT((mask[cpu / 64] >> (cpu % 64) & 1) != 0);
+
+    ASSERT(GetCpu(&cpu, nullptr) == 0);
+    ASSERT(cpu < nprocs);
+}
+
+int Main(int, char**, char**) {
+    RUN_TEST(TestClockGetTime);
+    RUN_TEST(TestGetAuxVal);
+    RUN_TEST(TestGetCpu);
+
+    return 0;
+}
@@ -1,3 +1,6 @@
+#include "tree-layout.hpp"
+
+#include <algorithm>
 #include <cerrno>
 #include <cstdint>
 #include <cstring>
@@ -8,19 +11,55 @@
 #include <unistd.h>
 #include <vector>
 
-struct Node {
-    int32_t key;
-    int32_t left_idx;
-    int32_t right_idx;
+constexpr size_t NodeSize = sizeof(Node);
+
+// Nodes are fetched by pages of whole nodes
+constexpr size_t PageNodes = 4096 / NodeSize;
+constexpr size_t PageBytes = PageNodes * NodeSize;
+// Direct-mapped cache of CachePages pages, the memory used does not depend on
+// the file size
+constexpr size_t CachePages = 256;
+// At most that many pages are fetched by one miss
+constexpr size_t BatchPages = 32;
+// Holes of at most that many pages between two fetched pages are fetched too,
+// so that both pages come with one pread
+constexpr size_t MaxGapPages = 2;
+// Longest run of pages fetched with one pread
+constexpr size_t MaxRunPages = 64;
+// Number of pages fetched at once when the file is in preorder layout
+constexpr size_t SequentialPages = 12;
+
+struct NodeCache {
+    int fd;
+    size_t node_count;
+    // Preorder files are traversed front to back, so the following pages are
+    // fetched together with the missing one
+    bool sequential = false;
+    std::vector<char> data = std::vector<char>(CachePages * PageBytes);
+    // Page held by each slot, -1 if none
+    std::vector<int64_t> tags = std::vector<int64_t>(CachePages, -1);
 };
 
-constexpr size_t NodeSize = sizeof(Node);
+static size_t page_count(const NodeCache& cache) {
+    return (cache.node_count + PageNodes - 1) / PageNodes;
+}
+
+static size_t page_bytes(const NodeCache& cache, size_t page) {
+    return std::min(PageNodes, cache.node_count - page * PageNodes) * NodeSize;
+}
 
-static bool pread_full(int fd, void* buf, size_t n, off_t off) {
-    size_t done = 0;
-    while (done < n) {
-        ssize_t r =
-            pread(fd, static_cast<char*>(buf) + done, n - done, off + done);
+static char* slot_data(NodeCache& cache, size_t page) {
+    return cache.data.data() + (page % CachePages) * PageBytes;
+}
+
+static bool is_cached(const NodeCache& cache, size_t page) {
+    return cache.tags[page % CachePages] == static_cast<int64_t>(page);
+}
+
+// Reads exactly `bytes` bytes at `off`, retrying short reads
+static bool pread_full(int fd, char* buf, size_t bytes, off_t off) {
+    while (bytes > 0) {
+        ssize_t r = pread(fd, buf, bytes, off);
         if (r == 0) {
             return false;
         }
@@ -30,29 +69,157 @@ static bool pread_full(int fd, void* buf, size_t n, off_t off) {
             }
             return false;
         }
-        done += static_cast<size_t>(r);
+        buf += r;
+        bytes -= static_cast<size_t>(r);
+        off += r;
     }
     return true;
 }
 
-static bool read_node(int fd, int32_t idx, size_t node_count, Node& out) {
-    if (idx < 0 || static_cast<size_t>(idx) >= node_count) {
-        std::cerr << "node index out of range: " << idx << '\n';
+// Fetches pages [first, last] with one pread per run of slots that are
+// adjacent in memory: the run is split only where the slot index wraps around
+static bool fetch_run(NodeCache& cache, size_t first, size_t last) {
+    for (size_t page = first; page <= last; ++page) {
+        cache.tags[page % CachePages] = -1;
+    }
+
+    for (size_t begin = first; begin <= last;) {
+        const size_t end =
+            std::min(last, begin + CachePages - 1 - begin % CachePages);
+        const size_t bytes =
+            (end - begin) * PageBytes + page_bytes(cache, end);
+        if (!pread_full(cache.fd, slot_data(cache, begin), bytes,
+                        static_cast<off_t>(begin * PageBytes))) {
+            return false;
+        }
+        begin = end + 1;
+    }
+
+    for (size_t page = first; page <= last; ++page) {
+        cache.tags[page % CachePages] = static_cast<int64_t>(page);
+    }
+    return true;
+}
+
+// Fetches the given pages, first ones have priority. The first `required`
+// pages are always fetched, the rest only when they come with the same pread
+// as some required page: a separate call for a page that may be never used
+// costs more than it saves. Pages competing for the same slot are dropped.
+static bool fetch_pages(NodeCache& cache, std::vector<size_t>& pages,
+                        size_t required) {
+    std::vector<bool> claimed(CachePages);
+    std::vector<bool> must_fetch(CachePages);
+    size_t kept = 0;
+    for (size_t i = 0; i < pages.size(); ++i) {
+        const size_t page = pages[i];
+        if (is_cached(cache, page) || claimed[page % CachePages]) {
+            continue;
+        }
+        claimed[page % CachePages] = true;
+        must_fetch[page % CachePages] = i < required;
+        pages[kept++] = page;
+    }
+    pages.resize(kept);
+    std::sort(pages.begin(), pages.end());
+
+    // Hole pages must not evict the pages of the batch
+    auto can_join = [&](size_t first, size_t from, size_t to) {
+        if (to - from > MaxGapPages + 1 || to - first >= MaxRunPages) {
+            return false;
+        }
+        for (size_t page = from + 1; page < to; ++page) {
+            if (claimed[page % CachePages]) {
+                return false;
+            }
+        }
+        for (size_t page = from + 1; page < to; ++page) {
+            claimed[page % CachePages] = true;
+        }
+        return true;
+    };
+
+    for (size_t i = 0; i < pages.size();) {
+        size_t j = i;
+        bool needed = must_fetch[pages[i] % CachePages];
+        while (j + 1 < pages.size() &&
+               can_join(pages[i], pages[j], pages[j + 1])) {
+            ++j;
+            needed = needed || must_fetch[pages[j] % CachePages];
+        }
+        if (needed && !fetch_run(cache, pages[i], pages[j])) {
+            return false;
+        }
+        i = j + 1;
+    }
+    return true;
+}
+
+// Only the first kLayoutSampleSize nodes are fetched to check the layout
+static bool detect_layout(NodeCache& cache) {
+    const size_t sample = std::min(cache.node_count, kLayoutSampleSize);
+    std::vector<size_t> pages;
+    for (size_t page = 0; page * PageNodes < sample; ++page) {
+        pages.push_back(page);
+    }
+    if (!fetch_pages(cache, pages, pages.size())) {
         return false;
     }
-    const off_t off = static_cast<off_t>(idx) * static_cast<off_t>(NodeSize);
-    char buf[NodeSize];
-    if (!pread_full(fd, buf, NodeSize, off)) {
-        std::cerr << "pread failed at index " << idx;
+
+    std::vector<Node> nodes(sample);
+    for (size_t i = 0; i < sample; ++i) {
+        std::memcpy(&nodes[i],
+                    slot_data(cache, i / PageNodes) + i % PageNodes * NodeSize,
+                    NodeSize);
+    }
+    cache.sequential = DetectLayout(nodes) == TreeLayout::Preorder;
+    return true;
+}
+
+// On a miss also fetches the pages that are going to be needed soon: the
+// following ones for preorder files, otherwise the pages of the left children
+// waiting on the traversal stack, topmost first
+static bool read_node(NodeCache& cache, int32_t idx,
+                      const std::vector<Node>& frontier, Node& out) {
+    if (idx < 0 || static_cast<size_t>(idx) >= cache.node_count) {
+        std::cerr << "node index out of range: " << idx << '\n';
         return false;
     }
-    std::memcpy(&out, buf, NodeSize);
+    const auto pos = static_cast<size_t>(idx);
+    const size_t page = pos / PageNodes;
+
+    if (!is_cached(cache, page)) {
+        std::vector<size_t> pages = {page};
+        if (cache.sequential) {
+            const size_t end =
+                std::min(page + SequentialPages, page_count(cache));
+            for (size_t next = page + 1; next < end; ++next) {
+                pages.push_back(next);
+            }
+        } else {
+            for (auto it = frontier.rbegin();
+                 it != frontier.rend() && pages.size() < BatchPages; ++it) {
+                if (it->left_idx > 0 &&
+                    static_cast<size_t>(it->left_idx) < cache.node_count) {
+                    pages.push_back(static_cast<size_t>(it->left_idx) /
+                                    PageNodes);
+                }
+            }
+        }
+        if (!fetch_pages(cache, pages, 1)) {
+            std::cerr << "pread failed at index " << idx
+                      << " (errno=" << errno << ")\n";
+            return false;
+        }
+    }
+
+    std::memcpy(&out, slot_data(cache, page) + pos % PageNodes * NodeSize,
+                NodeSize);
     return true;
 }
 
-static void reverse_in_order_traversal(int fd, int32_t idx, size_t node_count) {
+static bool reverse_in_order_traversal(NodeCache& cache, int32_t idx) {
     if (idx == 0) {
-        return;
+        return true;
     }
 
     std::vector<Node> st;
@@ -63,9 +230,8 @@ static void reverse_in_order_traversal(int fd, int32_t idx, size_t node_count) {
 
     while (cur != 0 || !st.empty()) {
         while (cur != 0) {
-            if (!read_node(fd, cur, node_count, n)) {
-                std::cerr << "Error: fail to read file" << idx
-                          << " (errno=" << errno << ")\n";
+            if (!read_node(cache, cur, st, n)) {
+                return false;
             }
             st.push_back(n);
             cur = n.right_idx;
@@ -77,6 +243,7 @@ static void reverse_in_order_traversal(int fd, int32_t idx, size_t node_count) {
         std::cout << n.key << ' ';
         cur = n.left_idx;
     }
+    return true;
 }
 
 int main(int argc, char* argv[]) {
@@ -109,15 +276,28 @@ int main(int argc, char* argv[]) {
     const size_t node_count =
         static_cast<size_t>(filesize / static_cast<off_t>(NodeSize));
 
+    NodeCache cache{.fd = fd, .node_count = node_count};
+    if (!detect_layout(cache)) {
+        std::cerr << "pread failed (errno=" << errno << ")\n";
+        close(fd);
+        return 1;
+    }
+
     Node root;
-    if (!read_node(fd, 0, node_count, root)) {
+    if (!read_node(cache, 0, {}, root)) {
         close(fd);
         return 1;
     }
 
-    reverse_in_order_traversal(fd, root.right_idx, node_count);
+    if (!reverse_in_order_traversal(cache, root.right_idx)) {
+        close(fd);
+        return 1;
+    }
     std::cout << root.key << ' ';
-    reverse_in_order_traversal(fd, root.left_idx, node_count);
+    if (!reverse_in_order_traversal(cache, root.left_idx)) {
+        close(fd);
+        return 1;
+    }
     std::cout << '\n';
 
     close(fd);
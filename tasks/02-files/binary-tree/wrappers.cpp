@@ -10,7 +10,12 @@
 #include <time.h>
 
 struct ReadGlitches final : ReadGuard, PReadGuard, ReadChkGuard, PReadChkGuard {
-    ReadGlitches() : rng_(424243) {
+    ReadGlitches()
+        : ReadGuard(GlitchScope::Process),
+          PReadGuard(GlitchScope::Process),
+          ReadChkGuard(GlitchScope::Process),
+          PReadChkGuard(GlitchScope::Process),
+          rng_(424243) {
         static constexpr int64_t kNsInSec = 1'000'000'000;
 
         const char* delay_str = getenv("READ_DELAY_NS");
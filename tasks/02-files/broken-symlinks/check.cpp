@@ -0,0 +1,62 @@
+#include "checker.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+
+// Checks long lists of paths, one per line, given on stdin or in a file.
+// Output has the same format as the solution and follows the input order.
+
+int main(int argc, char* argv[]) {
+    CheckOptions options{
+        .threads = std::max(1u, std::thread::hardware_concurrency()),
+    };
+    const char* from = nullptr;
+    bool from_stdin = false;
+    bool ok = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--stdin") {
+            from_stdin = true;
+        } else if (arg == "--cache-targets") {
+            options.cache_targets = true;
+        } else if (arg.starts_with("--from=")) {
+            from = argv[i] + 7;
+        } else if (arg.starts_with("--threads=")) {
+            auto value = arg.substr(10);
+            auto [ptr, ec] = std::from_chars(
+                value.data(), value.data() + value.size(), options.threads);
+            ok = ok && ec == std::errc{} &&
+                 ptr == value.data() + value.size() && options.threads > 0;
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || from_stdin == (from != nullptr)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " (--stdin | --from=FILE) [--threads=N] [--cache-targets]"
+                  << std::endl;
+        return 1;
+    }
+
+    int in_fd = STDIN_FILENO;
+    if (from) {
+        in_fd = open(from, O_RDONLY | O_CLOEXEC);
+        if (in_fd == -1) {
+            std::cerr << "Failed to open " << from << ": "
+                      << std::strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+
+    if (!CheckPaths(in_fd, STDOUT_FILENO, options)) {
+        std::cerr << "I/O error: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+}
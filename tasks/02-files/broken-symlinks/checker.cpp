@@ -0,0 +1,243 @@
+#include "checker.hpp"
+
+#include <write-all.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <memory>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Caches are dropped as a whole when they grow over these limits
+constexpr size_t kMaxCachedDirs = 1024;
+constexpr size_t kMaxCachedTargets = 64 * 1024;
+
+// Paths are handed to threads by chunks, and output is produced by batches of
+// chunks
+constexpr size_t kChunkPaths = 1024;
+constexpr size_t kChunksPerThread = 8;
+constexpr size_t kReadSize = 1 << 20;
+
+// Same checks as in the solution, used for paths which can't be split into a
+// parent directory and a name
+PathStatus CheckWhole(const char* path) {
+    struct stat st{};
+
+    if (lstat(path, &st) != 0) {
+        return PathStatus::Missing;
+    }
+    if (!S_ISLNK(st.st_mode)) {
+        return PathStatus::Ok;
+    }
+    return stat(path, &st) == 0 ? PathStatus::Ok : PathStatus::BrokenSymlink;
+}
+
+}  // namespace
+
+std::string_view StatusSuffix(PathStatus status) {
+    switch (status) {
+    case PathStatus::Missing:
+        return " (missing)";
+    case PathStatus::BrokenSymlink:
+        return " (broken symlink)";
+    default:
+        return "";
+    }
+}
+
+PathChecker::PathChecker(bool cache_targets) : cache_targets_{cache_targets} {
+}
+
+PathChecker::~PathChecker() {
+    for (auto [dir, fd] : dirs_) {
+        close(fd);
+    }
+}
+
+PathStatus PathChecker::Check(std::string_view path) {
+    const auto slash = path.rfind('/');
+    const auto name = slash == std::string_view::npos ? path
+                                                      : path.substr(slash + 1);
+    auto dir = slash == std::string_view::npos ? std::string_view{}
+                                               : path.substr(0, slash);
+    if (slash == 0) {
+        dir = "/";
+    }
+
+    int dir_fd = AT_FDCWD;
+    if (!dir.empty()) {
+        dir_fd = ParentFd(dir);
+    }
+    if (name.empty() || name == "." || name == ".." || dir_fd == -1) {
+        buffer_.assign(path);
+        return CheckWhole(buffer_.c_str());
+    }
+
+    buffer_.assign(name);
+    struct stat st{};
+
+    if (fstatat(dir_fd, buffer_.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        return PathStatus::Missing;
+    }
+    if (!S_ISLNK(st.st_mode)) {
+        return PathStatus::Ok;
+    }
+
+    bool exists = cache_targets_
+                      ? TargetExists(dir_fd, dir, buffer_.c_str())
+                      : fstatat(dir_fd, buffer_.c_str(), &st, 0) == 0;
+    return exists ? PathStatus::Ok : PathStatus::BrokenSymlink;
+}
+
+int PathChecker::ParentFd(std::string_view dir) {
+    std::string key{dir};
+    if (auto it = dirs_.find(key); it != dirs_.end()) {
+        return it->second;
+    }
+
+    int fd = open(key.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    if (dirs_.size() >= kMaxCachedDirs) {
+        for (auto [cached_dir, cached_fd] : dirs_) {
+            close(cached_fd);
+        }
+        dirs_.clear();
+    }
+    dirs_.emplace(std::move(key), fd);
+    return fd;
+}
+
+bool PathChecker::TargetExists(int dir_fd, std::string_view dir,
+                               const char* name) {
+    char target[PATH_MAX];
+    ssize_t size = readlinkat(dir_fd, name, target, sizeof(target));
+    if (size <= 0 || static_cast<size_t>(size) == sizeof(target)) {
+        struct stat st{};
+
+        return fstatat(dir_fd, name, &st, 0) == 0;
+    }
+
+    // Relative targets are resolved from the directory of the link
+    std::string key;
+    if (target[0] != '/') {
+        key = dir;
+        key += '\0';
+    }
+    key.append(target, size);
+    if (auto it = targets_.find(key); it != targets_.end()) {
+        return it->second;
+    }
+
+    struct stat st{};
+
+    bool exists = fstatat(dir_fd, name, &st, 0) == 0;
+    if (targets_.size() >= kMaxCachedTargets) {
+        targets_.clear();
+    }
+    targets_.emplace(std::move(key), exists);
+    return exists;
+}
+
+bool CheckPaths(int in_fd, int out_fd, const CheckOptions& options) {
+    const size_t threads = std::max(1u, options.threads);
+    const size_t batch_paths = threads * kChunksPerThread * kChunkPaths;
+
+    std::vector<std::unique_ptr<PathChecker>> checkers;
+    for (size_t i = 0; i < threads; ++i) {
+        checkers.push_back(
+            std::make_unique<PathChecker>(options.cache_targets));
+    }
+
+    std::string input;
+    size_t parsed = 0;
+    bool eof = false;
+    std::vector<std::string_view> paths;
+    std::vector<std::string> outputs;
+
+    while (!eof || parsed < input.size()) {
+        // Collect a batch of complete lines
+        paths.clear();
+        while (paths.size() < batch_paths) {
+            auto end = input.find('\n', parsed);
+            if (end == std::string::npos && !eof) {
+                if (!paths.empty()) {
+                    // Reading more would invalidate the views into input
+                    break;
+                }
+                input.erase(0, parsed);
+                parsed = 0;
+
+                auto old_size = input.size();
+                input.resize(old_size + kReadSize);
+                ssize_t ret = read(in_fd, input.data() + old_size, kReadSize);
+                if (ret == -1 && errno == EINTR) {
+                    input.resize(old_size);
+                    continue;
+                }
+                if (ret == -1) {
+                    return false;
+                }
+                input.resize(old_size + ret);
+                eof = ret == 0;
+                continue;
+            }
+            if (end == std::string::npos) {
+                if (parsed < input.size()) {
+                    paths.emplace_back(input.data() + parsed,
+                                       input.size() - parsed);
+                }
+                parsed = input.size();
+                break;
+            }
+            paths.emplace_back(input.data() + parsed, end - parsed);
+            parsed = end + 1;
+        }
+        if (paths.empty()) {
+            continue;
+        }
+
+        const size_t chunks = (paths.size() + kChunkPaths - 1) / kChunkPaths;
+        outputs.assign(chunks, {});
+        std::atomic<size_t> next_chunk = 0;
+        auto work = [&](PathChecker& checker) {
+            while (true) {
+                auto chunk = next_chunk.fetch_add(1);
+                if (chunk >= chunks) {
+                    return;
+                }
+                auto& out = outputs[chunk];
+                auto end = std::min(paths.size(), (chunk + 1) * kChunkPaths);
+                for (auto i = chunk * kChunkPaths; i < end; ++i) {
+                    out += paths[i];
+                    out += StatusSuffix(checker.Check(paths[i]));
+                    out += '\n';
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < std::min(threads, chunks); ++i) {
+            workers.emplace_back(work, std::ref(*checkers[i]));
+        }
+        work(*checkers[0]);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        for (const auto& out : outputs) {
+            if (!WriteAll(out_fd, out)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+enum class PathStatus {
+    Ok,
+    Missing,
+    BrokenSymlink,
+};
+
+// Suffix printed after the path, empty for PathStatus::Ok
+std::string_view StatusSuffix(PathStatus status);
+
+// Classifies paths the same way as the solution, but cheaper for long lists:
+// a path is looked up with one fstatat(AT_SYMLINK_NOFOLLOW) relative to its
+// parent directory, which is opened once and cached. Only symlinks need the
+// second, following, fstatat.
+//
+// Not thread-safe, every thread owns its checker.
+class PathChecker {
+  public:
+    // With cache_targets, the result of following a symlink is cached by its
+    // parent directory and target, so the chain is resolved once for all the
+    // siblings pointing to the same place
+    explicit PathChecker(bool cache_targets = false);
+
+    PathChecker(const PathChecker&) = delete;
+    PathChecker& operator=(const PathChecker&) = delete;
+
+    ~PathChecker();
+
+    PathStatus Check(std::string_view path);
+
+  private:
+    // Returns -1 if the parent can't be opened, the path is then checked as a
+    // whole
+    int ParentFd(std::string_view dir);
+    bool TargetExists(int dir_fd, std::string_view dir, const char* name);
+
+    const bool cache_targets_;
+    // Parent directories opened with O_PATH
+    std::unordered_map<std::string, int> dirs_;
+    std::unordered_map<std::string, bool> targets_;
+    std::string buffer_;
+};
+
+struct CheckOptions {
+    unsigned threads = 1;
+    bool cache_targets = false;
+};
+
+// Checks paths given one per line on in_fd and prints the results to out_fd
+// in the input order. Paths are processed by batches across a pool of
+// threads. Returns false on I/O errors.
+bool CheckPaths(int in_fd, int out_fd, const CheckOptions& options);
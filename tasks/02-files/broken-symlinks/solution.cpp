@@ -3,32 +3,38 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
-bool isFileExists(const char* path) {
-    struct stat buffer{};
+enum class PathStatus {
+    Ok,
+    Missing,
+    BrokenSymlink,
+};
 
-    return (stat(path, &buffer) == 0);
-}
-
-bool isBrokenLink(const char* path) {
-    struct stat link_stat{};
+// lstat alone answers for everything except symlinks, only they need the
+// second (following) stat
+PathStatus checkPath(const char* path) {
+    struct stat st{};
 
-    if (lstat(path, &link_stat) != 0) {
-        return true;
-    } else {
-        return false;
+    if (lstat(path, &st) != 0) {
+        return PathStatus::Missing;
+    }
+    if (!S_ISLNK(st.st_mode)) {
+        return PathStatus::Ok;
     }
+    return stat(path, &st) == 0 ? PathStatus::Ok : PathStatus::BrokenSymlink;
 }
 
 int main(int argc, const char* argv[]) {
     for (int i = 1; i < argc; ++i) {
-        if (!isFileExists(argv[i])) {
-            if (isBrokenLink(argv[i])) {
-                std::cout << argv[i] << " (missing)";
-            } else {
-                std::cout << argv[i] << " (broken symlink)";
-            }
-        } else {
-            std::cout << argv[i];
+        std::cout << argv[i];
+        switch (checkPath(argv[i])) {
+        case PathStatus::Missing:
+            std::cout << " (missing)";
+            break;
+        case PathStatus::BrokenSymlink:
+            std::cout << " (broken symlink)";
+            break;
+        default:
+            break;
         }
         std::cout << '\n';
     }
@@ -0,0 +1,149 @@
+#include "checker.hpp"
+
+#include <internal-assert.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Definition from the README
+PathStatus Reference(const std::string& path) {
+    struct stat st{};
+
+    if (stat(path.c_str(), &st) == 0) {
+        return PathStatus::Ok;
+    }
+    if (lstat(path.c_str(), &st) == 0) {
+        return PathStatus::BrokenSymlink;
+    }
+    return PathStatus::Missing;
+}
+
+class TempDir {
+  public:
+    TempDir() {
+        char path[] = "/tmp/broken-symlinks-XXXXXX";
+        INTERNAL_ASSERT(mkdtemp(path) != nullptr);
+        root_ = path;
+
+        Mkdir("dir");
+        Mkdir("dir/sub");
+        Touch("file");
+        Touch("dir/file");
+        Link("good", "file");
+        Link("bad", "nowhere");
+        Link("loop", "loop");
+        Link("chain", "good");
+        Link("dirlink", "dir");
+        Link("dir/up", "../file");
+        Link("dir/sub/up", "../file");
+        Link("dir/sub/up2", "../file");
+        Link("dir/absolute", root_ + "/file");
+    }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    ~TempDir() {
+        for (auto it = created_.rbegin(); it != created_.rend(); ++it) {
+            remove(it->c_str());
+        }
+        rmdir(root_.c_str());
+    }
+
+    std::vector<std::string> Paths() const {
+        std::vector<std::string> paths = {"", ".", "/", "/nonexistent/x"};
+        for (std::string suffix :
+             {"", "/", "/.", "/..", "/missing", "/file", "/good", "/bad",
+              "/loop", "/chain", "/dirlink", "/dirlink/", "/dirlink/file",
+              "/dirlink/up", "/bad/x", "/file/x", "/dir/up", "/dir/sub/up",
+              "/dir/sub/up2", "/dir/sub/../up", "/dir/absolute", "//file"}) {
+            paths.push_back(root_ + suffix);
+        }
+        return paths;
+    }
+
+  private:
+    void Mkdir(const std::string& path) {
+        INTERNAL_ASSERT(mkdir(Add(path).c_str(), 0755) == 0);
+    }
+
+    void Touch(const std::string& path) {
+        int fd = open(Add(path).c_str(), O_CREAT | O_WRONLY, 0644);
+        INTERNAL_ASSERT(fd != -1);
+        close(fd);
+    }
+
+    void Link(const std::string& path, const std::string& target) {
+        INTERNAL_ASSERT(symlink(target.c_str(), Add(path).c_str()) == 0);
+    }
+
+    std::string Add(const std::string& path) {
+        created_.push_back(root_ + "/" + path);
+        return created_.back();
+    }
+
+    std::string root_;
+    std::vector<std::string> created_;
+};
+
+TEST_CASE("PathChecker") {
+    TempDir dir;
+    for (bool cache_targets : {false, true}) {
+        PathChecker checker{cache_targets};
+        // Second round goes through the caches
+        for (int round = 0; round < 2; ++round) {
+            for (const auto& path : dir.Paths()) {
+                INFO("path = " << path << ", cache = " << cache_targets);
+                CHECK(checker.Check(path) == Reference(path));
+            }
+        }
+    }
+}
+
+TEST_CASE("CheckPaths") {
+    TempDir dir;
+    std::string input;
+    std::string expected;
+    for (int i = 0; i < 500; ++i) {
+        for (const auto& path : dir.Paths()) {
+            if (path.empty()) {
+                continue;
+            }
+            input += path + '\n';
+            expected += path;
+            expected += StatusSuffix(Reference(path));
+            expected += '\n';
+        }
+    }
+    // Last line may miss its newline
+    input += "/nonexistent";
+    expected += "/nonexistent (missing)\n";
+
+    for (unsigned threads : {1, 3}) {
+        int in_fd = memfd_create("in", 0);
+        int out_fd = memfd_create("out", 0);
+        INTERNAL_ASSERT(in_fd != -1);
+        INTERNAL_ASSERT(out_fd != -1);
+        auto written = write(in_fd, input.data(), input.size());
+        INTERNAL_ASSERT(written == static_cast<ssize_t>(input.size()));
+        lseek(in_fd, 0, SEEK_SET);
+
+        CheckOptions options{.threads = threads, .cache_targets = true};
+        REQUIRE(CheckPaths(in_fd, out_fd, options));
+
+        std::string output(lseek(out_fd, 0, SEEK_END), '\0');
+        auto ret = pread(out_fd, output.data(), output.size(), 0);
+        INTERNAL_ASSERT(ret == static_cast<ssize_t>(output.size()));
+        CHECK(output == expected);
+
+        close(in_fd);
+        close(out_fd);
+    }
+}
@@ -0,0 +1,537 @@
+#include "dir-index.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+constexpr size_t kFlushThreshold = 64 * 1024;
+
+bool IsEntryType(EntryType type) {
+    return type == EntryType::File || type == EntryType::Directory ||
+           type == EntryType::Symlink;
+}
+
+// Offsets and sizes come from the file, nothing is trusted
+bool IsConsistent(const IndexHeader& header, size_t file_size) {
+    if (std::memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic)) != 0) {
+        return false;
+    }
+    const uint64_t available = file_size - sizeof(IndexHeader);
+    if (header.dir_count > available / sizeof(IndexDir)) {
+        return false;
+    }
+    const uint64_t after_dirs = available - header.dir_count * sizeof(IndexDir);
+    if (header.entry_count > after_dirs / sizeof(IndexEntry)) {
+        return false;
+    }
+    return header.names_size ==
+           after_dirs - header.entry_count * sizeof(IndexEntry);
+}
+
+// Children must follow their parents, so printing always terminates
+bool IsConsistent(const DirIndexView& view, const IndexHeader& header) {
+    for (uint32_t idx = 0; idx < header.dir_count; ++idx) {
+        const auto& dir = view.Dir(idx);
+        if (dir.first_entry > header.entry_count ||
+            dir.entry_count > header.entry_count - dir.first_entry) {
+            return false;
+        }
+        for (const auto& entry : view.Entries(dir)) {
+            if (!IsEntryType(entry.type) ||
+                entry.name_offset > header.names_size ||
+                entry.name_size > header.names_size - entry.name_offset) {
+                return false;
+            }
+            if (entry.child != kNoDir &&
+                (entry.type != EntryType::Directory || entry.child <= idx ||
+                 entry.child >= header.dir_count)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+class IndexUpdater {
+  public:
+    IndexUpdater(const char* root, int root_fd, const DirIndexView& old,
+                 UpdateStats* stats,
+                 const std::unordered_set<std::string>* changed)
+        : root_{root},
+          root_fd_{root_fd},
+          old_{old},
+          stats_{stats},
+          changed_{changed} {
+        timespec now{};
+        clock_gettime(CLOCK_REALTIME, &now);
+        start_sec_ = now.tv_sec;
+    }
+
+    // Directories are opened relative to their parents, so paths longer than
+    // PATH_MAX are fine. At most kMaxOpenDirs of them are kept open: a parent
+    // closed to stay within the limit is opened again through ".." of its
+    // child or, failing that, by name from the closest open ancestor.
+    std::optional<DirIndexData> Run() {
+        const uint32_t old_root = old_.Empty() ? kNoDir : 0;
+        int root_fd = -1;
+        if (Enter(old_root, ".", &root_fd) == kNoDir) {
+            return std::nullopt;
+        }
+        Push({0, old_root, data_.dirs[0].first_entry, 0, root_fd});
+        while (!stack_.empty()) {
+            auto& frame = stack_.back();
+            const auto& dir = data_.dirs[frame.dir];
+            const auto end = dir.first_entry + dir.entry_count;
+            while (frame.next < end &&
+                   data_.entries[frame.next].type != EntryType::Directory) {
+                ++frame.next;
+            }
+            if (frame.next == end) {
+                Pop();
+                continue;
+            }
+
+            const auto entry = frame.next++;
+            const auto old_dir = frame.old_dir;
+            path_.resize(frame.path_size);
+            const std::string name{EntryName(data_.entries[entry])};
+            path_ += name;
+            path_ += '/';
+            const auto old_child = FindOldChild(old_dir, name);
+            int fd = -1;
+            const auto child = Enter(old_child, name, &fd);
+            if (child != kNoDir) {
+                data_.entries[entry].child = child;
+                Push({child, old_child, data_.dirs[child].first_entry,
+                      path_.size(), fd});
+            }
+        }
+        return std::move(data_);
+    }
+
+  private:
+    static constexpr size_t kMaxOpenDirs = 64;
+
+    struct Frame {
+        uint32_t dir;
+        uint32_t old_dir;
+        uint64_t next;
+        size_t path_size;
+        // -1 if the directory is not open
+        int fd;
+    };
+
+    struct Listed {
+        std::string name;
+        EntryType type;
+    };
+
+    // Adds the record of the directory at path_, named name in the directory
+    // on top of the stack, with its entries. Returns its index or kNoDir if
+    // the directory can't be opened. The directory is left open in *dir_fd
+    // unless it was reused without opening.
+    uint32_t Enter(uint32_t old_idx, const std::string& name, int* dir_fd) {
+        const IndexDir* old_dir =
+            old_idx == kNoDir ? nullptr : &old_.Dir(old_idx);
+        if (old_dir && changed_ && old_dir->mtime_sec != 0 &&
+            !changed_->contains(path_)) {
+            const auto idx = AddDir(*old_dir);
+            CopyEntries(*old_dir);
+            return idx;
+        }
+
+        const int parent_fd = stack_.empty() ? root_fd_ : TopFd();
+        int fd = parent_fd == -1
+                     ? -1
+                     : openat(parent_fd, name.c_str(),
+                              O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd == -1) {
+            Skip(errno);
+            return kNoDir;
+        }
+        *dir_fd = fd;
+
+        struct stat st{};
+
+        bool stat_ok = fstat(fd, &st) == 0;
+        bool complete = true;
+
+        const auto idx = AddDir({
+            .mtime_sec = st.st_mtim.tv_sec,
+            .mtime_nsec = st.st_mtim.tv_nsec,
+            .dev = st.st_dev,
+            .ino = st.st_ino,
+            .first_entry = 0,
+            .entry_count = 0,
+        });
+        if (stat_ok && old_dir && IsUnchanged(*old_dir, data_.dirs[idx])) {
+            CopyEntries(*old_dir);
+        } else {
+            complete = ListEntries(fd);
+            if (stats_) {
+                ++stats_->listed;
+            }
+        }
+
+        // A change made later within the same timestamp tick would keep the
+        // mtime, so recently modified directories are listed next time again.
+        // So are the ones that could not be listed till the end.
+        if (!stat_ok || !complete || st.st_mtim.tv_sec + 1 >= start_sec_) {
+            data_.dirs[idx].mtime_sec = 0;
+            data_.dirs[idx].mtime_nsec = 0;
+        }
+        if (stats_ && (!old_dir || old_dir->dev != data_.dirs[idx].dev ||
+                       old_dir->ino != data_.dirs[idx].ino)) {
+            stats_->added.push_back(path_);
+        }
+        return idx;
+    }
+
+    void Push(const Frame& frame) {
+        stack_.push_back(frame);
+        if (frame.fd != -1) {
+            ++open_dirs_;
+            CloseOldest();
+        }
+    }
+
+    // While the child is still open, the parent is opened through ".." if it
+    // was closed. The inode check protects from directories moved meanwhile.
+    void Pop() {
+        const int fd = stack_.back().fd;
+        stack_.pop_back();
+        first_open_ = std::min(first_open_, stack_.size());
+        if (fd == -1) {
+            return;
+        }
+
+        int parent_fd = -1;
+        if (!stack_.empty() && stack_.back().fd == -1) {
+            parent_fd = openat(fd, "..", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            struct stat st{};
+            const auto& parent = data_.dirs[stack_.back().dir];
+            if (parent_fd != -1 &&
+                (fstat(parent_fd, &st) == -1 || st.st_dev != parent.dev ||
+                 st.st_ino != parent.ino)) {
+                close(parent_fd);
+                parent_fd = -1;
+            }
+        }
+        close(fd);
+        --open_dirs_;
+        if (parent_fd != -1) {
+            SetFd(stack_.size() - 1, parent_fd);
+        }
+    }
+
+    void SetFd(size_t frame, int fd) {
+        stack_[frame].fd = fd;
+        ++open_dirs_;
+        first_open_ = std::min(first_open_, frame);
+        CloseOldest();
+    }
+
+    // The deepest directories are the ones needed next
+    void CloseOldest() {
+        while (open_dirs_ > kMaxOpenDirs) {
+            while (stack_[first_open_].fd == -1) {
+                ++first_open_;
+            }
+            close(stack_[first_open_].fd);
+            stack_[first_open_].fd = -1;
+            --open_dirs_;
+        }
+    }
+
+    // Descriptor of the directory on top of the stack, which is opened by
+    // name from its closest open ancestor if needed. Returns -1 with errno
+    // set if some directory on the way can't be opened.
+    int TopFd() {
+        size_t frame = stack_.size() - 1;
+        if (stack_[frame].fd != -1) {
+            return stack_[frame].fd;
+        }
+        while (frame > 0 && stack_[frame - 1].fd == -1) {
+            --frame;
+        }
+
+        int fd = frame == 0 ? root_fd_ : stack_[frame - 1].fd;
+        for (; frame < stack_.size(); ++frame) {
+            const std::string name =
+                frame == 0 ? "."
+                           : path_.substr(stack_[frame - 1].path_size,
+                                          stack_[frame].path_size -
+                                              stack_[frame - 1].path_size - 1);
+            fd = openat(fd, name.c_str(),
+                        O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (fd == -1) {
+                return -1;
+            }
+            SetFd(frame, fd);
+        }
+        return fd;
+    }
+
+    static bool IsUnchanged(const IndexDir& old_dir, const IndexDir& dir) {
+        return old_dir.mtime_sec != 0 && old_dir.mtime_sec == dir.mtime_sec &&
+               old_dir.mtime_nsec == dir.mtime_nsec &&
+               old_dir.dev == dir.dev && old_dir.ino == dir.ino;
+    }
+
+    // Entries are added right after, to the end of data_.entries
+    uint32_t AddDir(const IndexDir& dir) {
+        const auto idx = static_cast<uint32_t>(data_.dirs.size());
+        data_.dirs.push_back(dir);
+        data_.dirs.back().first_entry = data_.entries.size();
+        data_.dirs.back().entry_count = 0;
+        if (stats_) {
+            ++stats_->dirs;
+        }
+        return idx;
+    }
+
+    void AddEntry(std::string_view name, EntryType type) {
+        data_.entries.push_back({
+            .name_offset = data_.names.size(),
+            .name_size = static_cast<uint32_t>(name.size()),
+            .child = kNoDir,
+            .type = type,
+            .reserved = {},
+        });
+        data_.names += name;
+        ++data_.dirs.back().entry_count;
+    }
+
+    void CopyEntries(const IndexDir& old_dir) {
+        for (const auto& entry : old_.Entries(old_dir)) {
+            AddEntry(old_.Name(entry), entry.type);
+        }
+    }
+
+    // Returns false if the directory could not be listed till the end, the
+    // entries seen so far are added anyway
+    bool ListEntries(int fd) {
+        std::vector<Listed> listed;
+        bool complete = ForEachEntry(
+            fd, dirents_, [&](std::string_view name, EntryType type) {
+                listed.push_back({std::string{name}, type});
+            });
+        if (!complete) {
+            Skip(errno);
+        }
+        std::sort(listed.begin(), listed.end(),
+                  [](const Listed& lhs, const Listed& rhs) {
+                      return lhs.name < rhs.name;
+                  });
+        for (const auto& entry : listed) {
+            AddEntry(entry.name, entry.type);
+        }
+        return complete;
+    }
+
+    void Skip(int error) {
+        ReportError(root_, path_, error);
+        if (stats_) {
+            ++stats_->failed;
+        }
+    }
+
+    // Old entries are sorted by name as well
+    uint32_t FindOldChild(uint32_t old_idx, std::string_view name) const {
+        if (old_idx == kNoDir) {
+            return kNoDir;
+        }
+        auto entries = old_.Entries(old_.Dir(old_idx));
+        auto it = std::lower_bound(
+            entries.begin(), entries.end(), name,
+            [this](const IndexEntry& entry, std::string_view value) {
+                return old_.Name(entry) < value;
+            });
+        if (it == entries.end() || old_.Name(*it) != name ||
+            it->type != EntryType::Directory) {
+            return kNoDir;
+        }
+        return it->child;
+    }
+
+    std::string_view EntryName(const IndexEntry& entry) const {
+        return std::string_view{data_.names}.substr(entry.name_offset,
+                                                    entry.name_size);
+    }
+
+    const char* const root_;
+    const int root_fd_;
+    const DirIndexView& old_;
+    UpdateStats* const stats_;
+    const std::unordered_set<std::string>* const changed_;
+    time_t start_sec_ = 0;
+
+    DirIndexData data_;
+    std::vector<char> dirents_;
+    // Relative to the root, ends with '/' (empty for the root). May be longer
+    // than PATH_MAX, it is never passed to the kernel as a whole.
+    std::string path_;
+    std::vector<Frame> stack_;
+    size_t open_dirs_ = 0;
+    // Frames below it have no open directory
+    size_t first_open_ = 0;
+};
+
+}  // namespace
+
+DirIndexView::DirIndexView(const DirIndexData& data)
+    : dirs_{data.dirs}, entries_{data.entries}, names_{data.names} {
+}
+
+bool DirIndexView::Print(int out_fd) const {
+    if (Empty()) {
+        return true;
+    }
+
+    struct Frame {
+        uint32_t dir;
+        size_t next;
+        size_t path_size;
+    };
+
+    std::string out;
+    std::string path;
+    std::vector<Frame> stack = {{0, 0, 0}};
+    while (!stack.empty()) {
+        auto& frame = stack.back();
+        auto entries = Entries(Dir(frame.dir));
+        if (frame.next == entries.size()) {
+            stack.pop_back();
+            continue;
+        }
+
+        const auto& entry = entries[frame.next++];
+        path.resize(frame.path_size);
+        AppendLine(out, entry.type, path, Name(entry));
+        if (entry.child != kNoDir) {
+            path += Name(entry);
+            path += '/';
+            stack.push_back({entry.child, 0, path.size()});
+        }
+        if (out.size() >= kFlushThreshold) {
+            if (!WriteAll(out_fd, out)) {
+                return false;
+            }
+            out.clear();
+        }
+    }
+    return WriteAll(out_fd, out);
+}
+
+std::optional<MappedDirIndex> MappedDirIndex::Open(const char* path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return std::nullopt;
+    }
+
+    struct stat st{};
+
+    if (fstat(fd, &st) == -1 ||
+        static_cast<size_t>(st.st_size) < sizeof(IndexHeader)) {
+        close(fd);
+        return std::nullopt;
+    }
+
+    MappedDirIndex index;
+    index.size_ = st.st_size;
+    void* data = mmap(nullptr, index.size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return std::nullopt;
+    }
+    index.data_ = data;
+
+    const auto* bytes = static_cast<const char*>(data);
+    IndexHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (!IsConsistent(header, index.size_)) {
+        return std::nullopt;
+    }
+
+    const char* dirs = bytes + sizeof(IndexHeader);
+    const char* entries = dirs + header.dir_count * sizeof(IndexDir);
+    const char* names = entries + header.entry_count * sizeof(IndexEntry);
+    index.view_.dirs_ = {reinterpret_cast<const IndexDir*>(dirs),
+                         header.dir_count};
+    index.view_.entries_ = {reinterpret_cast<const IndexEntry*>(entries),
+                            header.entry_count};
+    index.view_.names_ = {names, header.names_size};
+    if (!IsConsistent(index.view_, header)) {
+        return std::nullopt;
+    }
+    return index;
+}
+
+MappedDirIndex::MappedDirIndex(MappedDirIndex&& other) noexcept
+    : data_{std::exchange(other.data_, nullptr)},
+      size_{std::exchange(other.size_, 0)},
+      view_{std::exchange(other.view_, {})} {
+}
+
+MappedDirIndex::~MappedDirIndex() {
+    if (data_) {
+        munmap(data_, size_);
+    }
+}
+
+std::optional<DirIndexData> UpdateIndex(
+    const char* root, const DirIndexView& old, UpdateStats* stats,
+    const std::unordered_set<std::string>* changed) {
+    int fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        return std::nullopt;
+    }
+    auto data = IndexUpdater{root, fd, old, stats, changed}.Run();
+    close(fd);
+    return data;
+}
+
+bool SaveIndex(const DirIndexData& data, const char* path) {
+    IndexHeader header{
+        .magic = {},
+        .dir_count = static_cast<uint32_t>(data.dirs.size()),
+        .reserved = 0,
+        .entry_count = data.entries.size(),
+        .names_size = data.names.size(),
+    };
+    std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+
+    std::string tmp_path = std::string{path} + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+    if (fd == -1) {
+        return false;
+    }
+
+    auto as_bytes = [](const auto& items) {
+        return std::string_view{reinterpret_cast<const char*>(items.data()),
+                                items.size() * sizeof(items[0])};
+    };
+    std::string_view header_bytes{reinterpret_cast<const char*>(&header),
+                                  sizeof(header)};
+    bool ok = WriteAll(fd, header_bytes) && WriteAll(fd, as_bytes(data.dirs)) &&
+              WriteAll(fd, as_bytes(data.entries)) &&
+              WriteAll(fd, data.names);
+    if (close(fd) == -1) {
+        ok = false;
+    }
+    if (!ok || rename(tmp_path.c_str(), path) == -1) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "walker.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Persistent index of a directory tree. The file is a header followed by
+// three arrays, so it is used directly from the mapping:
+//
+//   IndexHeader
+//   IndexDir[dir_count]        preorder, dirs[0] is the root
+//   IndexEntry[entry_count]    entries of every dir are contiguous and
+//                              sorted by name
+//   char[names_size]           entry names, not null-terminated
+//
+// Entries keep the listing rules of the walker (no hidden files etc.), the
+// index can be printed without touching the tree at all.
+
+inline constexpr char kIndexMagic[8] = {'C', 'A', 'O', 'S', 'I', 'D', 'X', '1'};
+inline constexpr uint32_t kNoDir = UINT32_MAX;
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t dir_count;
+    uint32_t reserved;
+    uint64_t entry_count;
+    uint64_t names_size;
+};
+
+struct IndexDir {
+    // Directory is listed again when any of these differ. A zero mtime means
+    // "always list again", see UpdateIndex.
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t first_entry;
+    uint64_t entry_count;
+};
+
+struct IndexEntry {
+    uint64_t name_offset;
+    uint32_t name_size;
+    // Index of the dir record for directories, kNoDir otherwise
+    uint32_t child;
+    EntryType type;
+    char reserved[7];
+};
+
+static_assert(sizeof(IndexHeader) == 32);
+static_assert(sizeof(IndexDir) == 48);
+static_assert(sizeof(IndexEntry) == 24);
+
+// In-memory form, used to build a new index
+struct DirIndexData {
+    std::vector<IndexDir> dirs;
+    std::vector<IndexEntry> entries;
+    std::string names;
+};
+
+// Read-only view of an index file or of DirIndexData
+class DirIndexView {
+  public:
+    DirIndexView() = default;
+    explicit DirIndexView(const DirIndexData& data);
+
+    bool Empty() const {
+        return dirs_.empty();
+    }
+
+    const IndexDir& Dir(uint32_t idx) const {
+        return dirs_[idx];
+    }
+
+    std::span<const IndexEntry> Entries(const IndexDir& dir) const {
+        return entries_.subspan(dir.first_entry, dir.entry_count);
+    }
+
+    std::string_view Name(const IndexEntry& entry) const {
+        return names_.substr(entry.name_offset, entry.name_size);
+    }
+
+    // Prints the listing in the order of `traverse_parallel --sorted`
+    bool Print(int out_fd) const;
+
+  private:
+    friend class MappedDirIndex;
+
+    std::span<const IndexDir> dirs_;
+    std::span<const IndexEntry> entries_;
+    std::string_view names_;
+};
+
+// Maps an index file. Files that are missing, truncated or inconsistent are
+// reported as absent, the index is then built from scratch.
+class MappedDirIndex {
+  public:
+    static std::optional<MappedDirIndex> Open(const char* path);
+
+    MappedDirIndex(MappedDirIndex&& other) noexcept;
+    MappedDirIndex& operator=(MappedDirIndex&&) = delete;
+    ~MappedDirIndex();
+
+    const DirIndexView& View() const {
+        return view_;
+    }
+
+  private:
+    MappedDirIndex() = default;
+
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    DirIndexView view_;
+};
+
+struct UpdateStats {
+    uint64_t dirs = 0;
+    // Directories whose contents were listed again
+    uint64_t listed = 0;
+    // Directories that could not be opened or listed till the end
+    uint64_t failed = 0;
+    // Directories that were opened and are new to the old index: missing
+    // there or with another device and inode. Paths are relative to the root
+    // as in the listing, empty for the root.
+    std::vector<std::string> added;
+};
+
+// Builds the index of the tree at root reusing `old`: directories with the
+// same mtime, device and inode as in `old` are not listed again, only opened
+// to check their subdirectories. With `changed` (paths as in
+// UpdateStats::added) directories of `old` outside of it are reused without
+// being opened at all. Directories that can't be opened or listed are
+// reported with ReportError and indexed without their contents, they are
+// listed again on the next update. Returns nullopt if root can't be opened.
+std::optional<DirIndexData> UpdateIndex(
+    const char* root, const DirIndexView& old, UpdateStats* stats = nullptr,
+    const std::unordered_set<std::string>* changed = nullptr);
+
+// Writes the index to a temporary file and renames it over path, so readers
+// of the old index never see a partially written one
+bool SaveIndex(const DirIndexData& data, const char* path);
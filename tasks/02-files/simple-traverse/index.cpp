@@ -0,0 +1,253 @@
+#include "dir-index.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <string>
+#include <string_view>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Keeps a persistent index of a directory tree and prints the listing from
+// it. Only directories whose mtime changed since the previous run are listed
+// again.
+//
+//   traverse_index <dir> <index>            update the index, print listing
+//   traverse_index <dir> <index> --cached   print listing from the index as is
+//   traverse_index <dir> <index> --watch    keep the index up to date
+
+namespace {
+
+constexpr uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+                                IN_ONLYDIR | IN_DONT_FOLLOW;
+// Events are collected until the tree is quiet for that long
+constexpr int kSettleMs = 100;
+
+int Fail(const char* what, const char* path) {
+    std::cerr << what << ' ' << path << ": " << std::strerror(errno)
+              << std::endl;
+    return 1;
+}
+
+// Paths of watched directories by watch descriptor, relative to the root as
+// in UpdateStats::added
+using WatchMap = std::unordered_map<int, std::string>;
+
+// Directories that are gone by now are skipped: the event on their parent
+// triggers another update anyway. Returns false on other errors.
+bool AddWatch(int inotify_fd, const std::string& root, const std::string& path,
+              WatchMap& watched) {
+    std::string full_path = root + '/' + path;
+    int wd = inotify_add_watch(inotify_fd, full_path.c_str(), kWatchMask);
+    if (wd == -1) {
+        if (errno == ENOENT || errno == ENOTDIR || errno == ELOOP) {
+            return true;
+        }
+        Fail("Failed to watch", full_path.c_str());
+        return false;
+    }
+    // A directory that is already watched gets the same descriptor back
+    watched[wd] = path;
+    return true;
+}
+
+// Watches every indexed directory
+bool AddWatches(int inotify_fd, const std::string& root,
+                const DirIndexView& view, WatchMap& watched) {
+    struct Frame {
+        uint32_t dir;
+        size_t path_size;
+    };
+
+    std::string path;
+    std::vector<Frame> stack = {{0, 0}};
+    while (!stack.empty()) {
+        auto [dir, path_size] = stack.back();
+        stack.pop_back();
+        path.resize(path_size);
+        if (!AddWatch(inotify_fd, root, path, watched)) {
+            return false;
+        }
+
+        for (const auto& entry : view.Entries(view.Dir(dir))) {
+            if (entry.child == kNoDir) {
+                continue;
+            }
+            path.resize(path_size);
+            path += view.Name(entry);
+            path += '/';
+            stack.push_back({entry.child, path.size()});
+        }
+    }
+    return true;
+}
+
+// A directory that moved stops being watched together with its subtree. If
+// it is still inside the tree, it is found under the new path on the update
+// and watched again.
+void RemoveWatches(int inotify_fd, const std::string& path,
+                   WatchMap& watched) {
+    std::erase_if(watched, [&](const auto& item) {
+        if (!item.second.starts_with(path)) {
+            return false;
+        }
+        inotify_rm_watch(inotify_fd, item.first);
+        return true;
+    });
+}
+
+// Collects the directories whose contents changed into `changed`. Sets
+// `overflow` if events were lost and the whole tree has to be checked.
+// Returns false on errors.
+bool WaitForChanges(int inotify_fd, WatchMap& watched,
+                    std::unordered_set<std::string>& changed, bool& overflow) {
+    alignas(inotify_event) char buffer[64 * 1024];
+    pollfd pfd{.fd = inotify_fd, .events = POLLIN, .revents = 0};
+    int timeout = -1;
+    while (true) {
+        int ret = poll(&pfd, 1, timeout);
+        if (ret == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (ret == 0) {
+            return true;
+        }
+        ssize_t size = read(inotify_fd, buffer, sizeof(buffer));
+        if (size == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        for (ssize_t pos = 0; pos < size;) {
+            const auto* event =
+                reinterpret_cast<const inotify_event*>(buffer + pos);
+            pos += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+            auto it = watched.find(event->wd);
+            if (it == watched.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                watched.erase(it);
+                continue;
+            }
+            changed.insert(it->second);
+            if (event->mask & IN_MOVE_SELF) {
+                RemoveWatches(inotify_fd, std::string{it->second}, watched);
+            }
+        }
+        timeout = kSettleMs;
+    }
+}
+
+int Watch(const char* root, const char* index_path, DirIndexData data) {
+    int inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (inotify_fd == -1) {
+        return Fail("Failed to watch", root);
+    }
+
+    WatchMap watched;
+    if (!AddWatches(inotify_fd, root, DirIndexView{data}, watched)) {
+        close(inotify_fd);
+        return 1;
+    }
+
+    while (true) {
+        std::unordered_set<std::string> changed;
+        bool overflow = false;
+        if (!WaitForChanges(inotify_fd, watched, changed, overflow)) {
+            close(inotify_fd);
+            return Fail("Failed to watch", root);
+        }
+
+        // Only the directories with events are opened, unless some events
+        // were lost
+        UpdateStats stats;
+        auto updated = UpdateIndex(root, DirIndexView{data}, &stats,
+                                   overflow ? nullptr : &changed);
+        if (!updated) {
+            close(inotify_fd);
+            return Fail("Failed to open", root);
+        }
+        data = std::move(*updated);
+        if (!SaveIndex(data, index_path)) {
+            close(inotify_fd);
+            return Fail("Failed to save", index_path);
+        }
+
+        bool watching = true;
+        if (overflow) {
+            watching =
+                AddWatches(inotify_fd, root, DirIndexView{data}, watched);
+        } else {
+            for (const auto& path : stats.added) {
+                if (!AddWatch(inotify_fd, root, path, watched)) {
+                    watching = false;
+                    break;
+                }
+            }
+        }
+        if (!watching) {
+            close(inotify_fd);
+            return 1;
+        }
+        std::cerr << "Index updated: " << stats.listed << " of " << stats.dirs
+                  << " directories listed" << std::endl;
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::string_view mode = argc == 4 ? argv[3] : "";
+    if ((argc != 3 && argc != 4) ||
+        (argc == 4 && mode != "--cached" && mode != "--watch")) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <directory_path> <index> [--cached | --watch]"
+                  << std::endl;
+        return 1;
+    }
+    const char* root = argv[1];
+    const char* index_path = argv[2];
+
+    auto old = MappedDirIndex::Open(index_path);
+    if (mode == "--cached") {
+        if (!old) {
+            std::cerr << "No valid index at " << index_path << std::endl;
+            return 1;
+        }
+        return old->View().Print(STDOUT_FILENO) ? 0 : 1;
+    }
+
+    UpdateStats stats;
+    auto data = UpdateIndex(root, old ? old->View() : DirIndexView{}, &stats);
+    if (!data) {
+        return Fail("Failed to open", root);
+    }
+    if (!SaveIndex(*data, index_path)) {
+        return Fail("Failed to save", index_path);
+    }
+
+    if (mode == "--watch") {
+        old.reset();
+        return Watch(root, index_path, std::move(*data));
+    }
+    // Directories that failed are reported already, the listing is printed
+    // without them
+    bool printed = DirIndexView{*data}.Print(STDOUT_FILENO);
+    return printed && stats.failed == 0 ? 0 : 1;
+}
@@ -21,20 +21,20 @@ void pathDfs(const std::string& root_dir, const std::string& relative_path) {
         switch (entry->d_type) {
         case DT_DIR: {
             std::string next_path = relative_path + entry->d_name;
-            std::cout << "d " << next_path << '/' << std::endl;
+            std::cout << "d " << next_path << "/\n";
             pathDfs(root_dir, next_path + "/");
             break;
         }
         case DT_REG: {
             if (entry->d_name[0] != '.') {
                 std::string file_path = relative_path + entry->d_name;
-                std::cout << "f " << file_path << std::endl;
+                std::cout << "f " << file_path << '\n';
             }
             break;
         }
         case DT_LNK: {
             std::string link_path = relative_path + entry->d_name;
-            std::cout << "l " << link_path << std::endl;
+            std::cout << "l " << link_path << '\n';
             break;
         }
         default: {
@@ -0,0 +1,380 @@
+#include "dir-index.hpp"
+#include "walker.hpp"
+
+#include <internal-assert.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+class TempTree {
+  public:
+    TempTree() {
+        char path[] = "/tmp/simple-traverse-XXXXXX";
+        INTERNAL_ASSERT(mkdtemp(path) != nullptr);
+        root_ = path;
+    }
+
+    TempTree(const TempTree&) = delete;
+    TempTree& operator=(const TempTree&) = delete;
+
+    ~TempTree() {
+        // Paths are removed children first
+        std::sort(created_.rbegin(), created_.rend());
+        for (const auto& path : created_) {
+            remove(path.c_str());
+        }
+        rmdir(root_.c_str());
+    }
+
+    void Dir(const std::string& path) {
+        INTERNAL_ASSERT(mkdir(Add(path).c_str(), 0755) == 0);
+    }
+
+    void File(const std::string& path) {
+        int fd = open(Add(path).c_str(), O_CREAT | O_WRONLY, 0644);
+        INTERNAL_ASSERT(fd != -1);
+        close(fd);
+    }
+
+    void Link(const std::string& path, const std::string& target) {
+        INTERNAL_ASSERT(symlink(target.c_str(), Add(path).c_str()) == 0);
+    }
+
+    // Moves mtimes of everything into the past, as if the tree was not
+    // touched for a while
+    void Age() {
+        const timespec times[2] = {{.tv_sec = 1'000'000'000, .tv_nsec = 0},
+                                   {.tv_sec = 1'000'000'000, .tv_nsec = 0}};
+        utimensat(AT_FDCWD, root_.c_str(), times, AT_SYMLINK_NOFOLLOW);
+        for (const auto& path : created_) {
+            utimensat(AT_FDCWD, path.c_str(), times, AT_SYMLINK_NOFOLLOW);
+        }
+    }
+
+    const std::string& Root() const {
+        return root_;
+    }
+
+  private:
+    std::string Add(const std::string& path) {
+        created_.push_back(root_ + "/" + path);
+        return created_.back();
+    }
+
+    std::string root_;
+    std::vector<std::string> created_;
+};
+
+std::string Walk(const std::string& root, const WalkOptions& options) {
+    int fd = memfd_create("walk", 0);
+    INTERNAL_ASSERT(fd != -1);
+    REQUIRE(WalkTree(root.c_str(), options, fd));
+
+    std::string out(lseek(fd, 0, SEEK_END), '\0');
+    auto ret = pread(fd, out.data(), out.size(), 0);
+    INTERNAL_ASSERT(ret == static_cast<ssize_t>(out.size()));
+    close(fd);
+    return out;
+}
+
+std::vector<std::string> SortedLines(const std::string& out) {
+    std::vector<std::string> lines;
+    size_t begin = 0;
+    while (begin < out.size()) {
+        auto end = out.find('\n', begin);
+        lines.push_back(out.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    std::sort(lines.begin(), lines.end());
+    return lines;
+}
+
+TEST_CASE("Listing") {
+    TempTree tree;
+    tree.File("a");
+    tree.Dir("b");
+    tree.File("b/c");
+    tree.File("b/.hidden");
+    tree.Dir("d");
+    tree.Dir("d/e");
+    tree.Dir("d/e/.f");
+    tree.File("d/e/.f/g");
+    tree.Link("l", "b");
+    tree.Link("d/broken", "nowhere");
+
+    const std::string expected =
+        "f a\n"
+        "d b/\n"
+        "f b/c\n"
+        "d d/\n"
+        "l d/broken\n"
+        "d d/e/\n"
+        "d d/e/.f/\n"
+        "f d/e/.f/g\n"
+        "l l\n";
+
+    for (unsigned threads : {1, 2, 5}) {
+        INFO("threads = " << threads);
+        CHECK(Walk(tree.Root(), {.threads = threads, .sorted = true}) ==
+              expected);
+        CHECK(SortedLines(Walk(tree.Root(), {.threads = threads})) ==
+              SortedLines(expected));
+    }
+}
+
+TEST_CASE("WideTree") {
+    TempTree tree;
+    std::string expected;
+    for (int i = 0; i < 20; ++i) {
+        auto dir = "dir" + std::to_string(i);
+        tree.Dir(dir);
+        for (int j = 0; j < 20; ++j) {
+            tree.File(dir + "/file" + std::to_string(j));
+        }
+    }
+
+    auto sorted = Walk(tree.Root(), {.threads = 1, .sorted = true});
+    CHECK(SortedLines(sorted).size() == 20 * 21);
+    for (unsigned threads : {2, 4, 8}) {
+        CHECK(Walk(tree.Root(), {.threads = threads, .sorted = true}) ==
+              sorted);
+        CHECK(SortedLines(Walk(tree.Root(), {.threads = threads})) ==
+              SortedLines(sorted));
+    }
+}
+
+std::string Print(const DirIndexView& view) {
+    int fd = memfd_create("index", 0);
+    INTERNAL_ASSERT(fd != -1);
+    REQUIRE(view.Print(fd));
+
+    std::string out(lseek(fd, 0, SEEK_END), '\0');
+    auto ret = pread(fd, out.data(), out.size(), 0);
+    INTERNAL_ASSERT(ret == static_cast<ssize_t>(out.size()));
+    close(fd);
+    return out;
+}
+
+TEST_CASE("Index") {
+    TempTree tree;
+    tree.File("a");
+    tree.Dir("b");
+    tree.File("b/c");
+    tree.Dir("d");
+    tree.Dir("d/e");
+    tree.File("d/e/f");
+    tree.Link("d/l", "e");
+    tree.Age();
+
+    UpdateStats stats;
+    auto data = UpdateIndex(tree.Root().c_str(), {}, &stats);
+    REQUIRE(data.has_value());
+    CHECK(stats.dirs == 4);
+    CHECK(stats.listed == 4);
+    CHECK(Print(DirIndexView{*data}) ==
+          Walk(tree.Root(), {.threads = 1, .sorted = true}));
+
+    auto index_path = tree.Root() + ".idx";
+    REQUIRE(SaveIndex(*data, index_path.c_str()));
+    {
+        auto index = MappedDirIndex::Open(index_path.c_str());
+        REQUIRE(index.has_value());
+        CHECK(Print(index->View()) == Print(DirIndexView{*data}));
+
+        stats = {};
+        auto same = UpdateIndex(tree.Root().c_str(), index->View(), &stats);
+        REQUIRE(same.has_value());
+        CHECK(stats.listed == 0);
+        CHECK(Print(DirIndexView{*same}) == Print(index->View()));
+    }
+
+    // Only the changed directory is listed again, recent mtime makes it
+    // listed on the next update as well
+    tree.File("d/e/g");
+    for (int i = 0; i < 2; ++i) {
+        stats = {};
+        auto updated = UpdateIndex(tree.Root().c_str(), DirIndexView{*data},
+                                   &stats);
+        REQUIRE(updated.has_value());
+        CHECK(stats.listed == 1);
+        CHECK(Print(DirIndexView{*updated}) ==
+              Walk(tree.Root(), {.threads = 1, .sorted = true}));
+        data = std::move(updated);
+    }
+
+    REQUIRE(truncate(index_path.c_str(), 40) == 0);
+    CHECK_FALSE(MappedDirIndex::Open(index_path.c_str()).has_value());
+    unlink(index_path.c_str());
+    CHECK_FALSE(MappedDirIndex::Open(index_path.c_str()).has_value());
+}
+
+TEST_CASE("IndexChanged") {
+    TempTree tree;
+    tree.Dir("a");
+    tree.Dir("a/b");
+    tree.File("a/b/c");
+    tree.Dir("d");
+    tree.Dir("x");
+    tree.Age();
+
+    UpdateStats stats;
+    auto data = UpdateIndex(tree.Root().c_str(), {}, &stats);
+    REQUIRE(data.has_value());
+    CHECK(stats.added ==
+          std::vector<std::string>{"", "a/", "a/b/", "d/", "x/"});
+
+    // Directories outside of the changed set are not even opened, so the new
+    // file is not seen yet
+    tree.File("a/b/e");
+    tree.Dir("d/f");
+    const std::unordered_set<std::string> changed_d = {"d/"};
+    stats = {};
+    auto updated =
+        UpdateIndex(tree.Root().c_str(), DirIndexView{*data}, &stats,
+                    &changed_d);
+    REQUIRE(updated.has_value());
+    CHECK(stats.dirs == 6);
+    CHECK(stats.listed == 2);
+    CHECK(stats.failed == 0);
+    CHECK(stats.added == std::vector<std::string>{"d/f/"});
+    CHECK(Print(DirIndexView{*updated}).find("a/b/e") == std::string::npos);
+    data = std::move(updated);
+
+    const std::unordered_set<std::string> changed_b = {"a/b/"};
+    stats = {};
+    updated = UpdateIndex(tree.Root().c_str(), DirIndexView{*data}, &stats,
+                          &changed_b);
+    REQUIRE(updated.has_value());
+    CHECK(Print(DirIndexView{*updated}) ==
+          Walk(tree.Root(), {.threads = 1, .sorted = true}));
+    data = std::move(updated);
+
+    // Directory is gone, but its parent is reused: it is reported and left
+    // without contents
+    REQUIRE(rmdir((tree.Root() + "/x").c_str()) == 0);
+    const std::unordered_set<std::string> changed_x = {"x/"};
+    stats = {};
+    updated = UpdateIndex(tree.Root().c_str(), DirIndexView{*data}, &stats,
+                          &changed_x);
+    REQUIRE(updated.has_value());
+    CHECK(stats.failed == 1);
+    CHECK(Print(DirIndexView{*updated}).ends_with("d x/\n"));
+}
+
+// Chain of directories nested deeper than PATH_MAX, created and removed
+// relative to each other. Every level also has a file "f" and an empty
+// directory "s", which come after the next level in the listing.
+class DeepTree {
+  public:
+    static constexpr size_t kDepth = 100;
+
+    explicit DeepTree(const std::string& root) {
+        fds_.push_back(open(root.c_str(), O_RDONLY | O_DIRECTORY));
+        INTERNAL_ASSERT(fds_.back() != -1);
+        for (size_t level = 0; level < kDepth; ++level) {
+            const int parent = fds_.back();
+            INTERNAL_ASSERT(mkdirat(parent, Name(level).c_str(), 0755) == 0);
+            INTERNAL_ASSERT(mkdirat(parent, "s", 0755) == 0);
+            int fd = openat(parent, "f", O_CREAT | O_WRONLY, 0644);
+            INTERNAL_ASSERT(fd != -1);
+            close(fd);
+            fds_.push_back(openat(parent, Name(level).c_str(),
+                                  O_RDONLY | O_DIRECTORY));
+            INTERNAL_ASSERT(fds_.back() != -1);
+        }
+    }
+
+    DeepTree(const DeepTree&) = delete;
+    DeepTree& operator=(const DeepTree&) = delete;
+
+    ~DeepTree() {
+        close(fds_.back());
+        for (size_t level = kDepth; level-- > 0;) {
+            const int parent = fds_[level];
+            unlinkat(parent, Name(level).c_str(), AT_REMOVEDIR);
+            unlinkat(parent, "s", AT_REMOVEDIR);
+            unlinkat(parent, "f", 0);
+            close(parent);
+        }
+    }
+
+    // Same as TempTree::Age
+    void Age() {
+        const timespec times[2] = {{.tv_sec = 1'000'000'000, .tv_nsec = 0},
+                                   {.tv_sec = 1'000'000'000, .tv_nsec = 0}};
+        futimens(fds_[0], times);
+        for (size_t level = 0; level < kDepth; ++level) {
+            futimens(fds_[level + 1], times);
+            utimensat(fds_[level], "s", times, 0);
+            utimensat(fds_[level], "f", times, 0);
+        }
+    }
+
+    // Descriptor of the directory at the given depth, 0 for the root
+    int Fd(size_t depth) const {
+        return fds_[depth];
+    }
+
+    static std::string Name(size_t level) {
+        return std::string(100, static_cast<char>('a' + level % 5));
+    }
+
+    // Relative to the root, as in UpdateStats::added
+    static std::string Path(size_t depth) {
+        std::string path;
+        for (size_t level = 0; level < depth; ++level) {
+            path += Name(level) + '/';
+        }
+        return path;
+    }
+
+  private:
+    std::vector<int> fds_;
+};
+
+TEST_CASE("IndexDeepTree") {
+    TempTree tree;
+    DeepTree deep{tree.Root()};
+    deep.Age();
+
+    UpdateStats stats;
+    auto data = UpdateIndex(tree.Root().c_str(), {}, &stats);
+    REQUIRE(data.has_value());
+    CHECK(stats.failed == 0);
+    CHECK(stats.dirs == 2 * DeepTree::kDepth + 1);
+    auto lines = SortedLines(Print(DirIndexView{*data}));
+    CHECK(lines.size() == 3 * DeepTree::kDepth);
+    CHECK(std::ranges::count(lines, "f " + DeepTree::Path(90) + "f") == 1);
+
+    // Only the changed directory is opened, by name from the root
+    constexpr size_t kChanged = 90;
+    int fd = openat(deep.Fd(kChanged), "s/g", O_CREAT | O_WRONLY, 0644);
+    REQUIRE(fd != -1);
+    close(fd);
+    const std::unordered_set<std::string> changed = {
+        DeepTree::Path(kChanged) + "s/"};
+    stats = {};
+    auto updated = UpdateIndex(tree.Root().c_str(), DirIndexView{*data},
+                               &stats, &changed);
+    REQUIRE(updated.has_value());
+    CHECK(stats.failed == 0);
+    CHECK(stats.listed == 1);
+    lines = SortedLines(Print(DirIndexView{*updated}));
+    CHECK(lines.size() == 3 * DeepTree::kDepth + 1);
+    CHECK(std::ranges::count(lines, "f " + *changed.begin() + "g") == 1);
+    unlinkat(deep.Fd(kChanged), "s/g", 0);
+}
+
+TEST_CASE("MissingRoot") {
+    CHECK_FALSE(WalkTree("/nonexistent/dir", {}, STDOUT_FILENO));
+}
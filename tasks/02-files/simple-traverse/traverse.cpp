@@ -0,0 +1,45 @@
+#include "walker.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+
+// Same listing as the solution, but directories are listed in parallel.
+// With --sorted the output does not depend on the number of threads.
+
+int main(int argc, char* argv[]) {
+    WalkOptions options{
+        .threads = std::max(1u, std::thread::hardware_concurrency()),
+    };
+    const char* root = nullptr;
+    bool ok = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--sorted") {
+            options.sorted = true;
+        } else if (arg.starts_with("--threads=")) {
+            auto value = arg.substr(10);
+            auto [ptr, ec] = std::from_chars(
+                value.data(), value.data() + value.size(), options.threads);
+            ok = ok && ec == std::errc{} &&
+                 ptr == value.data() + value.size() && options.threads > 0;
+        } else if (!root && !arg.starts_with("--")) {
+            root = argv[i];
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || !root) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <directory_path> [--threads=N] [--sorted]" << std::endl;
+        return 1;
+    }
+
+    if (!WalkTree(root, options, STDOUT_FILENO)) {
+        std::cerr << "Failed to list " << root << std::endl;
+        return 1;
+    }
+}
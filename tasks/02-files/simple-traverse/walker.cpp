@@ -0,0 +1,311 @@
+#include "walker.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+// Per-thread output is handed to out_fd in chunks of about that size
+constexpr size_t kFlushThreshold = 64 * 1024;
+
+// Keeps a directory open while its subdirectories wait to be opened relative
+// to it
+struct DirHandle {
+    explicit DirHandle(int fd) : fd{fd} {
+    }
+
+    DirHandle(const DirHandle&) = delete;
+    DirHandle& operator=(const DirHandle&) = delete;
+
+    ~DirHandle() {
+        close(fd);
+    }
+
+    const int fd;
+};
+
+// In sorted mode the whole tree is kept until the walk finishes
+struct DirNode {
+    struct Entry {
+        std::string name;
+        EntryType type;
+        std::unique_ptr<DirNode> child;
+    };
+
+    std::vector<Entry> entries;
+};
+
+struct Task {
+    // Null for the root
+    std::shared_ptr<DirHandle> parent{};
+    // Relative to the root, ends with '/' (empty for the root)
+    std::string path{};
+    // Name of the directory in its parent starts here
+    size_t name_begin = 0;
+    // Sorted mode only
+    DirNode* node = nullptr;
+};
+
+class Walker {
+  public:
+    Walker(const char* root, const WalkOptions& options, int out_fd)
+        : root_path_{root},
+          options_{options},
+          out_fd_{out_fd},
+          workers_(std::max(1u, options.threads)) {
+    }
+
+    bool Run(int root_fd) {
+        root_fd_ = root_fd;
+        Push(0, Task{.node = options_.sorted ? &root_ : nullptr});
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < workers_.size(); ++i) {
+            threads.emplace_back([this, i] { Work(i); });
+        }
+        Work(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        if (options_.sorted) {
+            PrintSorted();
+        }
+        return !failed_.load();
+    }
+
+  private:
+    struct Worker {
+        std::mutex mutex;
+        // Owner works on the back, thieves take from the front: directories
+        // near the root carry more work
+        std::deque<Task> tasks;
+    };
+
+    void Push(size_t self, Task task) {
+        pending_.fetch_add(1);
+        std::lock_guard guard{workers_[self].mutex};
+        workers_[self].tasks.push_back(std::move(task));
+    }
+
+    bool Pop(size_t self, Task& task) {
+        {
+            auto& own = workers_[self];
+            std::lock_guard guard{own.mutex};
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < workers_.size(); ++i) {
+            auto& victim = workers_[(self + i) % workers_.size()];
+            std::lock_guard guard{victim.mutex};
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Work(size_t self) {
+        std::vector<char> dirents;
+        std::string out;
+        Task task;
+        while (true) {
+            if (Pop(self, task)) {
+                Process(self, task, dirents, out);
+                pending_.fetch_sub(1);
+            } else if (pending_.load() == 0) {
+                break;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        Flush(out);
+    }
+
+    void Process(size_t self, Task& task, std::vector<char>& dirents,
+                 std::string& out) {
+        int fd = root_fd_;
+        if (task.parent) {
+            auto name = task.path.substr(task.name_begin);
+            name.pop_back();
+            fd = openat(task.parent->fd, name.c_str(),
+                        O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            const int error = errno;
+            task.parent.reset();
+            if (fd == -1) {
+                Skip(task.path, error);
+                return;
+            }
+        }
+        auto handle = std::make_shared<DirHandle>(fd);
+
+        auto push_child = [&](std::string_view name, DirNode* node) {
+            std::string path;
+            path.reserve(task.path.size() + name.size() + 1);
+            path += task.path;
+            path += name;
+            path += '/';
+            Push(self, Task{.parent = handle,
+                            .path = std::move(path),
+                            .name_begin = task.path.size(),
+                            .node = node});
+        };
+
+        if (!options_.sorted) {
+            auto print = [&](std::string_view name, EntryType type) {
+                AppendLine(out, type, task.path, name);
+                if (type == EntryType::Directory) {
+                    push_child(name, nullptr);
+                }
+            };
+            if (!ForEachEntry(fd, dirents, print)) {
+                Skip(task.path, errno);
+            }
+            if (out.size() >= kFlushThreshold) {
+                Flush(out);
+            }
+            return;
+        }
+
+        auto& entries = task.node->entries;
+        auto collect = [&](std::string_view name, EntryType type) {
+            entries.push_back({
+                .name = std::string{name},
+                .type = type,
+                .child = type == EntryType::Directory
+                             ? std::make_unique<DirNode>()
+                             : nullptr,
+            });
+        };
+        if (!ForEachEntry(fd, dirents, collect)) {
+            Skip(task.path, errno);
+        }
+        std::sort(entries.begin(), entries.end(),
+                  [](const auto& lhs, const auto& rhs) {
+                      return lhs.name < rhs.name;
+                  });
+        for (auto& entry : entries) {
+            if (entry.child) {
+                push_child(entry.name, entry.child.get());
+            }
+        }
+    }
+
+    // The subtree is left out, the walk goes on and fails in the end
+    void Skip(std::string_view path, int error) {
+        failed_.store(true);
+        ReportError(root_path_, path, error);
+    }
+
+    void Flush(std::string& out) {
+        if (out.empty()) {
+            return;
+        }
+        {
+            std::lock_guard guard{output_mutex_};
+            if (!WriteAll(out_fd_, out)) {
+                failed_.store(true);
+            }
+        }
+        out.clear();
+    }
+
+    // Depth-first, a directory is followed by its contents
+    void PrintSorted() {
+        struct Frame {
+            const DirNode* node;
+            size_t next;
+            size_t path_size;
+        };
+
+        std::string out;
+        std::string path;
+        std::vector<Frame> stack = {{&root_, 0, 0}};
+        while (!stack.empty()) {
+            auto& frame = stack.back();
+            if (frame.next == frame.node->entries.size()) {
+                path.resize(frame.path_size);
+                stack.pop_back();
+                continue;
+            }
+
+            const auto& entry = frame.node->entries[frame.next++];
+            path.resize(frame.path_size);
+            AppendLine(out, entry.type, path, entry.name);
+            if (entry.child) {
+                path += entry.name;
+                path += '/';
+                stack.push_back({entry.child.get(), 0, path.size()});
+            }
+            if (out.size() >= kFlushThreshold) {
+                Flush(out);
+            }
+        }
+        Flush(out);
+    }
+
+    const char* const root_path_;
+    const WalkOptions& options_;
+    const int out_fd_;
+    int root_fd_ = -1;
+
+    std::vector<Worker> workers_;
+    // Tasks queued or being processed
+    std::atomic<size_t> pending_ = 0;
+
+    std::mutex output_mutex_;
+    std::atomic<bool> failed_ = false;
+
+    DirNode root_;
+};
+
+}  // namespace
+
+void ReportError(const char* root, std::string_view path, int error) {
+    // Trailing '/' of the path is dropped
+    std::string message = root;
+    if (!path.empty()) {
+        message += '/';
+        message += path.substr(0, path.size() - 1);
+    }
+    message += ": ";
+    message += std::strerror(error);
+    message += '\n';
+    // A single write keeps messages of different threads apart
+    WriteAll(STDERR_FILENO, message);
+}
+
+void AppendLine(std::string& out, EntryType type, std::string_view path,
+                std::string_view name) {
+    out += static_cast<char>(type);
+    out += ' ';
+    out += path;
+    out += name;
+    if (type == EntryType::Directory) {
+        out += '/';
+    }
+    out += '\n';
+}
+
+bool WalkTree(const char* root, const WalkOptions& options, int out_fd) {
+    int fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    return Walker{root, options, out_fd}.Run(fd);
+}
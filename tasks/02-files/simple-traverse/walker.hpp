@@ -0,0 +1,108 @@
+#pragma once
+
+#include <write-all.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <vector>
+
+// Entries visible in the listing, the values are the type letters printed
+enum class EntryType : char {
+    File = 'f',
+    Directory = 'd',
+    Symlink = 'l',
+};
+
+// getdents64 returns as many entries as fit, large buffers mean fewer calls
+inline constexpr size_t kDirentBufferSize = 256 * 1024;
+
+namespace detail {
+
+inline bool ResolveType(int dir_fd, const char* name, unsigned char d_type,
+                        EntryType& type) {
+    if (d_type == DT_UNKNOWN) {
+        // Some filesystems do not fill d_type
+        struct stat st{};
+
+        if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == -1) {
+            return false;
+        }
+        d_type = IFTODT(st.st_mode);
+    }
+
+    switch (d_type) {
+    case DT_DIR:
+        type = EntryType::Directory;
+        return true;
+    case DT_REG:
+        type = EntryType::File;
+        return name[0] != '.';
+    case DT_LNK:
+        type = EntryType::Symlink;
+        return true;
+    default:
+        return false;
+    }
+}
+
+}  // namespace detail
+
+// Calls callback(name, type) for every entry of the directory that belongs to
+// the listing: "." and "..", hidden files and special files are skipped.
+// Returns false if the directory could not be listed till the end.
+template <class F>
+bool ForEachEntry(int dir_fd, std::vector<char>& buffer, F&& callback) {
+    buffer.resize(kDirentBufferSize);
+    while (true) {
+        ssize_t size = getdents64(dir_fd, buffer.data(), buffer.size());
+        if (size == 0) {
+            return true;
+        }
+        if (size < 0) {
+            return false;
+        }
+
+        for (ssize_t pos = 0; pos < size;) {
+            const auto* entry =
+                reinterpret_cast<const dirent64*>(buffer.data() + pos);
+            pos += entry->d_reclen;
+
+            const char* name = entry->d_name;
+            if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0) {
+                continue;
+            }
+            EntryType type;
+            if (detail::ResolveType(dir_fd, name, entry->d_type, type)) {
+                callback(std::string_view{name}, type);
+            }
+        }
+    }
+}
+
+// Appends the "t path" line of an entry of the directory at path (relative to
+// the root, ends with '/')
+void AppendLine(std::string& out, EntryType type, std::string_view path,
+                std::string_view name);
+
+// Prints "<root>/<path>: <error>" to stderr, path as in the listing
+void ReportError(const char* root, std::string_view path, int error);
+
+struct WalkOptions {
+    unsigned threads = 1;
+    // Print entries in depth-first order with names sorted bytewise inside
+    // every directory, the same for any number of threads
+    bool sorted = false;
+};
+
+// Prints the listing of root to out_fd, one "t path" line per entry, paths
+// relative to root. Directories are listed from a pool of threads. Returns
+// false if root can't be opened or the output can't be written. Directories
+// below root that can't be opened or listed are reported with ReportError,
+// the rest of the tree is still listed and false is returned in the end.
+bool WalkTree(const char* root, const WalkOptions& options, int out_fd);
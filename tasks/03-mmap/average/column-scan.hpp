@@ -0,0 +1,410 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <sys/fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// Element types a column file may consist of
+template <class T>
+concept ColumnType =
+    std::same_as<T, int32_t> || std::same_as<T, int64_t> ||
+    std::same_as<T, float> || std::same_as<T, double>;
+
+// Aggregators consume a column block by block. Every block is handed to all
+// of the aggregators before moving to the next one, so the block stays in L1
+// and the mapping is walked exactly once no matter how many statistics are
+// requested.
+template <class A, class T>
+concept ColumnAggregator = requires(A& agg, std::span<const T> block) {
+    { agg.Consume(block) };
+};
+
+// Number of elements handed to the aggregators at once (32KiB of doubles)
+inline constexpr size_t kScanBlockSize = 4096;
+
+// Independent accumulators per aggregator. Lets the compiler keep several
+// vector registers busy instead of serializing on a single dependency chain.
+inline constexpr size_t kScanLanes = 8;
+
+template <ColumnType T, ColumnAggregator<T>... Aggs>
+void ScanColumn(std::span<const T> data, Aggs&... aggs) {
+    for (size_t pos = 0; pos < data.size(); pos += kScanBlockSize) {
+        auto block =
+            data.subspan(pos, std::min(kScanBlockSize, data.size() - pos));
+        (aggs.Consume(block), ...);
+    }
+}
+
+// Count, mean and variance. Each block is summarized with a two-pass
+// mean/M2 computation (it is already in cache) and merged into the total with
+// Chan's formula, which keeps the variance numerically stable.
+template <ColumnType T>
+class Moments {
+  public:
+    void Consume(std::span<const T> block) {
+        if (block.empty()) {
+            return;
+        }
+
+        double lanes[kScanLanes] = {};
+        size_t i = 0;
+        for (; i + kScanLanes <= block.size(); i += kScanLanes) {
+            for (size_t l = 0; l < kScanLanes; ++l) {
+                lanes[l] += static_cast<double>(block[i + l]);
+            }
+        }
+        double sum = 0;
+        for (; i < block.size(); ++i) {
+            sum += static_cast<double>(block[i]);
+        }
+        for (auto lane : lanes) {
+            sum += lane;
+        }
+
+        auto n = static_cast<double>(block.size());
+        double mean = sum / n;
+
+        double sq_lanes[kScanLanes] = {};
+        i = 0;
+        for (; i + kScanLanes <= block.size(); i += kScanLanes) {
+            for (size_t l = 0; l < kScanLanes; ++l) {
+                double d = static_cast<double>(block[i + l]) - mean;
+                sq_lanes[l] += d * d;
+            }
+        }
+        double m2 = 0;
+        for (; i < block.size(); ++i) {
+            double d = static_cast<double>(block[i]) - mean;
+            m2 += d * d;
+        }
+        for (auto lane : sq_lanes) {
+            m2 += lane;
+        }
+
+        Merge(block.size(), mean, m2);
+    }
+
+    size_t Count() const {
+        return count_;
+    }
+
+    double Mean() const {
+        return mean_;
+    }
+
+    // Population variance, same as numpy.var
+    double Variance() const {
+        return count_ == 0 ? 0 : m2_ / static_cast<double>(count_);
+    }
+
+    double StdDev() const {
+        return std::sqrt(Variance());
+    }
+
+  private:
+    void Merge(size_t count, double mean, double m2) {
+        auto total = count_ + count;
+        double delta = mean - mean_;
+        double weight = static_cast<double>(count) / static_cast<double>(total);
+        mean_ += delta * weight;
+        m2_ += m2 + delta * delta * static_cast<double>(count_) * weight;
+        count_ = total;
+    }
+
+    size_t count_ = 0;
+    double mean_ = 0;
+    double m2_ = 0;
+};
+
+template <ColumnType T>
+class MinMax {
+  public:
+    void Consume(std::span<const T> block) {
+        T lo[kScanLanes];
+        T hi[kScanLanes];
+        std::fill(std::begin(lo), std::end(lo), min_);
+        std::fill(std::begin(hi), std::end(hi), max_);
+
+        size_t i = 0;
+        for (; i + kScanLanes <= block.size(); i += kScanLanes) {
+            for (size_t l = 0; l < kScanLanes; ++l) {
+                lo[l] = std::min(lo[l], block[i + l]);
+                hi[l] = std::max(hi[l], block[i + l]);
+            }
+        }
+        for (; i < block.size(); ++i) {
+            min_ = std::min(min_, block[i]);
+            max_ = std::max(max_, block[i]);
+        }
+        for (size_t l = 0; l < kScanLanes; ++l) {
+            min_ = std::min(min_, lo[l]);
+            max_ = std::max(max_, hi[l]);
+        }
+    }
+
+    // Both are meaningless for an empty column
+    T Min() const {
+        return min_;
+    }
+
+    T Max() const {
+        return max_;
+    }
+
+  private:
+    // NB: NaNs never compare less or greater, so std::min/std::max skip them
+    T min_ = std::numeric_limits<T>::has_infinity
+                 ? std::numeric_limits<T>::infinity()
+                 : std::numeric_limits<T>::max();
+    T max_ = std::numeric_limits<T>::has_infinity
+                 ? -std::numeric_limits<T>::infinity()
+                 : std::numeric_limits<T>::lowest();
+};
+
+// Fixed-width bins over [lo, hi). Values outside of the range (and NaNs) are
+// accounted separately, so the range has to be known before the scan.
+template <ColumnType T>
+class Histogram {
+  public:
+    Histogram(double lo, double hi, size_t bins)
+        : lo_{lo}, hi_{hi}, scale_{static_cast<double>(bins) / (hi - lo)},
+          counts_(bins) {
+        if (bins == 0 || !(lo < hi)) {
+            throw std::invalid_argument("invalid histogram range");
+        }
+    }
+
+    void Consume(std::span<const T> block) {
+        auto last = counts_.size() - 1;
+        for (auto value : block) {
+            auto x = static_cast<double>(value);
+            if (x >= lo_ && x < hi_) {
+                auto bin = static_cast<size_t>((x - lo_) * scale_);
+                // Rounding may push values close to hi_ out of range
+                ++counts_[std::min(bin, last)];
+            } else if (x < lo_) {
+                ++underflow_;
+            } else {
+                ++overflow_;
+            }
+        }
+    }
+
+    std::span<const uint64_t> Counts() const {
+        return counts_;
+    }
+
+    // Left boundary of the given bin, BinStart(Counts().size()) == hi
+    double BinStart(size_t bin) const {
+        return lo_ + static_cast<double>(bin) / scale_;
+    }
+
+    uint64_t Underflow() const {
+        return underflow_;
+    }
+
+    // Includes NaNs
+    uint64_t Overflow() const {
+        return overflow_;
+    }
+
+  private:
+    double lo_;
+    double hi_;
+    double scale_;
+    std::vector<uint64_t> counts_;
+    uint64_t underflow_ = 0;
+    uint64_t overflow_ = 0;
+};
+
+// Quantile sketch with relative accuracy guarantee (DDSketch): every value is
+// put into a logarithmic bucket, so a reported quantile differs from the real
+// one by at most `accuracy` relative error. Works in a single pass without
+// knowing the range and takes O(log(max / min) / accuracy) memory.
+// https://arxiv.org/abs/1908.10693
+template <ColumnType T>
+class QuantileSketch {
+  public:
+    explicit QuantileSketch(double accuracy = 0.01)
+        : gamma_{(1 + accuracy) / (1 - accuracy)},
+          inv_log_gamma_{1 / std::log(gamma_)} {
+        if (!(accuracy > 0 && accuracy < 1)) {
+            throw std::invalid_argument("accuracy must be in (0, 1)");
+        }
+    }
+
+    void Consume(std::span<const T> block) {
+        for (auto value : block) {
+            auto x = static_cast<double>(value);
+            // Infinities have no bucket and NaNs no rank, both are skipped
+            if (!std::isfinite(x)) {
+                continue;
+            }
+            if (x > kMinIndexable) {
+                positive_.Add(Index(x));
+            } else if (x < -kMinIndexable) {
+                negative_.Add(Index(-x));
+            } else {
+                ++zeros_;
+            }
+        }
+    }
+
+    uint64_t Count() const {
+        return negative_.total + zeros_ + positive_.total;
+    }
+
+    // q in [0, 1]. Returns 0 for an empty sketch
+    double Quantile(double q) const {
+        auto count = Count();
+        if (count == 0) {
+            return 0;
+        }
+        auto rank = static_cast<uint64_t>(
+            std::clamp(q, 0.0, 1.0) * static_cast<double>(count - 1));
+
+        if (rank < negative_.total) {
+            // Negative values are stored by magnitude, walk from the largest
+            uint64_t seen = 0;
+            for (size_t i = negative_.counts.size(); i-- > 0;) {
+                seen += negative_.counts[i];
+                if (seen > rank) {
+                    return -Value(negative_.offset + static_cast<int64_t>(i));
+                }
+            }
+        }
+        rank -= std::min(rank, negative_.total);
+
+        if (rank < zeros_) {
+            return 0;
+        }
+        rank -= zeros_;
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < positive_.counts.size(); ++i) {
+            seen += positive_.counts[i];
+            if (seen > rank) {
+                return Value(positive_.offset + static_cast<int64_t>(i));
+            }
+        }
+        return Value(positive_.offset +
+                     static_cast<int64_t>(positive_.counts.size()) - 1);
+    }
+
+  private:
+    static constexpr double kMinIndexable = 1e-300;
+
+    struct Buckets {
+        void Add(int64_t idx) {
+            if (counts.empty()) {
+                offset = idx;
+                counts.push_back(0);
+            } else if (idx < offset) {
+                counts.insert(counts.begin(), static_cast<size_t>(offset - idx),
+                              0);
+                offset = idx;
+            } else if (idx >= offset + static_cast<int64_t>(counts.size())) {
+                counts.resize(static_cast<size_t>(idx - offset + 1));
+            }
+            ++counts[static_cast<size_t>(idx - offset)];
+            ++total;
+        }
+
+        int64_t offset = 0;
+        std::vector<uint64_t> counts;
+        uint64_t total = 0;
+    };
+
+    int64_t Index(double x) const {
+        return static_cast<int64_t>(std::ceil(std::log(x) * inv_log_gamma_));
+    }
+
+    // Middle of the bucket in terms of relative error
+    double Value(int64_t idx) const {
+        return 2 * std::pow(gamma_, static_cast<double>(idx)) / (gamma_ + 1);
+    }
+
+    double gamma_;
+    double inv_log_gamma_;
+    Buckets negative_;
+    Buckets positive_;
+    uint64_t zeros_ = 0;
+};
+
+// Read-only mapping of a binary file containing an array of T
+template <ColumnType T>
+class MappedColumn {
+  public:
+    explicit MappedColumn(const char* path) {
+        int fd = open(path, O_RDONLY);
+        if (fd == -1) {
+            throw std::runtime_error("failed to open file " +
+                                     std::string{path});
+        }
+
+        struct stat st{};
+
+        if (fstat(fd, &st) == -1) {
+            close(fd);
+            throw std::runtime_error("failed to stat file " +
+                                     std::string{path});
+        }
+
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ % sizeof(T) != 0) {
+            close(fd);
+            throw std::runtime_error(
+                "file size is not a multiple of the element size");
+        }
+
+        if (size_ != 0) {
+            data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (data_ == MAP_FAILED) {
+            throw std::runtime_error("error mapping file " + std::string{path});
+        }
+
+        // The scan is strictly sequential, let the kernel read ahead
+        if (data_ != nullptr) {
+            madvise(data_, size_, MADV_SEQUENTIAL);
+        }
+    }
+
+    MappedColumn(const MappedColumn&) = delete;
+    MappedColumn& operator=(const MappedColumn&) = delete;
+
+    MappedColumn(MappedColumn&& other) noexcept
+        : data_{std::exchange(other.data_, nullptr)},
+          size_{std::exchange(other.size_, 0)} {
+    }
+
+    MappedColumn& operator=(MappedColumn&&) = delete;
+
+    std::span<const T> Data() const {
+        return {static_cast<const T*>(data_), size_ / sizeof(T)};
+    }
+
+    ~MappedColumn() {
+        if (data_ != nullptr) {
+            munmap(data_, size_);
+        }
+    }
+
+  private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
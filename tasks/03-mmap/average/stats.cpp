@@ -0,0 +1,202 @@
+#include "column-scan.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+enum class ElementType {
+    Int32,
+    Int64,
+    Float,
+    Double,
+};
+
+struct HistogramOptions {
+    size_t bins;
+    double lo;
+    double hi;
+};
+
+struct Options {
+    const char* path = nullptr;
+    ElementType type = ElementType::Double;
+    std::vector<double> quantiles = {0.5, 0.9, 0.99};
+    std::optional<HistogramOptions> histogram;
+};
+
+void PrintUsage(const char* name) {
+    std::cerr << "Usage: " << name
+              << " <file> [--type=double|float|int32|int64]"
+                 " [--quantiles=q1,q2,...] [--histogram=bins:lo:hi]\n";
+}
+
+template <class T>
+bool ParseNumber(std::string_view str, T& out) {
+    auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), out);
+    return ec == std::errc{} && ptr == str.data() + str.size();
+}
+
+// Splits `str` by `sep` and parses every part
+template <class T>
+std::optional<std::vector<T>> ParseList(std::string_view str, char sep) {
+    std::vector<T> result;
+    while (true) {
+        auto pos = str.find(sep);
+        T value;
+        if (!ParseNumber(str.substr(0, pos), value)) {
+            return std::nullopt;
+        }
+        result.push_back(value);
+        if (pos == std::string_view::npos) {
+            return result;
+        }
+        str.remove_prefix(pos + 1);
+    }
+}
+
+std::optional<Options> ParseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--type=")) {
+            arg.remove_prefix(7);
+            if (arg == "int32") {
+                options.type = ElementType::Int32;
+            } else if (arg == "int64") {
+                options.type = ElementType::Int64;
+            } else if (arg == "float") {
+                options.type = ElementType::Float;
+            } else if (arg == "double") {
+                options.type = ElementType::Double;
+            } else {
+                return std::nullopt;
+            }
+        } else if (arg.starts_with("--quantiles=")) {
+            auto quantiles = ParseList<double>(arg.substr(12), ',');
+            if (!quantiles) {
+                return std::nullopt;
+            }
+            options.quantiles = std::move(*quantiles);
+        } else if (arg.starts_with("--histogram=")) {
+            arg.remove_prefix(12);
+            auto colon = arg.find(':');
+            HistogramOptions histogram;
+            if (colon == std::string_view::npos ||
+                !ParseNumber(arg.substr(0, colon), histogram.bins)) {
+                return std::nullopt;
+            }
+            auto range = ParseList<double>(arg.substr(colon + 1), ':');
+            if (!range || range->size() != 2) {
+                return std::nullopt;
+            }
+            histogram.lo = (*range)[0];
+            histogram.hi = (*range)[1];
+            options.histogram = histogram;
+        } else if (options.path == nullptr && !arg.starts_with("--")) {
+            options.path = argv[i];
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    if (options.path == nullptr) {
+        return std::nullopt;
+    }
+    return options;
+}
+
+struct NoHistogram {
+    template <class T>
+    void Consume(std::span<const T>) {
+    }
+};
+
+template <class T>
+void PrintHistogram(const Histogram<T>& histogram) {
+    auto counts = histogram.Counts();
+    std::cout << "histogram underflow " << histogram.Underflow() << '\n';
+    for (size_t i = 0; i < counts.size(); ++i) {
+        std::cout << "histogram [" << histogram.BinStart(i) << ", "
+                  << histogram.BinStart(i + 1) << ") " << counts[i] << '\n';
+    }
+    std::cout << "histogram overflow " << histogram.Overflow() << '\n';
+}
+
+void PrintHistogram(const NoHistogram&) {
+}
+
+template <class T, class H>
+void PrintStats(const Options& options, std::span<const T> data,
+                H& histogram) {
+    Moments<T> moments;
+    MinMax<T> min_max;
+    QuantileSketch<T> sketch;
+
+    ScanColumn(data, moments, min_max, sketch, histogram);
+
+    std::cout << "count " << moments.Count() << '\n';
+    if (moments.Count() == 0) {
+        return;
+    }
+
+    std::cout << std::setprecision(17);
+    std::cout << "mean " << moments.Mean() << '\n';
+    std::cout << "min " << min_max.Min() << '\n';
+    std::cout << "max " << min_max.Max() << '\n';
+    std::cout << "variance " << moments.Variance() << '\n';
+    std::cout << "stddev " << moments.StdDev() << '\n';
+    for (auto q : options.quantiles) {
+        std::cout << "quantile " << q << ' ' << sketch.Quantile(q) << '\n';
+    }
+    PrintHistogram(histogram);
+}
+
+template <class T>
+void Run(const Options& options) {
+    MappedColumn<T> column{options.path};
+    if (options.histogram) {
+        Histogram<T> histogram{options.histogram->lo, options.histogram->hi,
+                               options.histogram->bins};
+        PrintStats(options, column.Data(), histogram);
+    } else {
+        NoHistogram histogram;
+        PrintStats(options, column.Data(), histogram);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    auto options = ParseOptions(argc, argv);
+    if (!options) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        switch (options->type) {
+        case ElementType::Int32:
+            Run<int32_t>(*options);
+            break;
+        case ElementType::Int64:
+            Run<int64_t>(*options);
+            break;
+        case ElementType::Float:
+            Run<float>(*options);
+            break;
+        case ElementType::Double:
+            Run<double>(*options);
+            break;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,158 @@
+#include "column-scan.hpp"
+
+#include <internal-assert.hpp>
+#include <pcg-random.hpp>
+
+#include <catch2/catch_get_random_seed.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+template <class T>
+std::vector<T> GenerateColumn(size_t size, PCGRandom& rng) {
+    std::vector<T> data(size);
+    for (auto& x : data) {
+        auto r = static_cast<int64_t>(rng.Generate64() % 2'000'001) - 1'000'000;
+        if constexpr (std::is_floating_point_v<T>) {
+            x = static_cast<T>(r) / 128;
+        } else {
+            x = static_cast<T>(r);
+        }
+    }
+    return data;
+}
+
+template <class T>
+void CheckColumn(const std::vector<T>& data) {
+    Moments<T> moments;
+    MinMax<T> min_max;
+    QuantileSketch<T> sketch{0.01};
+    Histogram<T> histogram{-1e5, 1e5, 10};
+
+    ScanColumn(std::span<const T>{data}, moments, min_max, sketch, histogram);
+
+    REQUIRE(moments.Count() == data.size());
+
+    double sum = 0;
+    for (auto x : data) {
+        sum += static_cast<double>(x);
+    }
+    double mean = sum / static_cast<double>(data.size());
+    double m2 = 0;
+    for (auto x : data) {
+        m2 += (static_cast<double>(x) - mean) * (static_cast<double>(x) - mean);
+    }
+    double variance = m2 / static_cast<double>(data.size());
+
+    CHECK(std::abs(moments.Mean() - mean) <= 1e-9 * (1 + std::abs(mean)));
+    CHECK(std::abs(moments.Variance() - variance) <= 1e-9 * variance);
+
+    CHECK(min_max.Min() == *std::min_element(data.begin(), data.end()));
+    CHECK(min_max.Max() == *std::max_element(data.begin(), data.end()));
+
+    auto sorted = data;
+    std::sort(sorted.begin(), sorted.end());
+    for (auto q : {0.0, 0.1, 0.5, 0.9, 0.99, 1.0}) {
+        auto rank =
+            static_cast<size_t>(q * static_cast<double>(data.size() - 1));
+        auto expected = static_cast<double>(sorted[rank]);
+        INFO("q = " << q);
+        CHECK(std::abs(sketch.Quantile(q) - expected) <=
+              0.01 * std::abs(expected) + 1e-9);
+    }
+
+    auto counts = histogram.Counts();
+    CHECK(std::accumulate(counts.begin(), counts.end(), uint64_t{0}) +
+              histogram.Underflow() + histogram.Overflow() ==
+          data.size());
+    for (size_t i = 0; i < counts.size(); ++i) {
+        auto in_bin = std::count_if(data.begin(), data.end(), [&](T x) {
+            auto v = static_cast<double>(x);
+            return v >= histogram.BinStart(i) && v < histogram.BinStart(i + 1);
+        });
+        CHECK(counts[i] == static_cast<uint64_t>(in_bin));
+    }
+}
+
+TEST_CASE("QuantileSketchSkipsNonFinite") {
+    constexpr double kInf = std::numeric_limits<double>::infinity();
+    constexpr double kNan = std::numeric_limits<double>::quiet_NaN();
+    const std::vector<double> data = {kInf, 1, -kInf, 2, kNan, 3, -kNan};
+
+    QuantileSketch<double> sketch{0.01};
+    sketch.Consume(std::span<const double>{data});
+
+    REQUIRE(sketch.Count() == 3);
+    CHECK(std::abs(sketch.Quantile(0) - 1) <= 0.01);
+    CHECK(std::abs(sketch.Quantile(0.5) - 2) <= 0.02);
+    CHECK(std::abs(sketch.Quantile(1) - 3) <= 0.03);
+}
+
+TEST_CASE("Aggregators") {
+    PCGRandom rng{Catch::getSeed()};
+    rng.Warmup();
+
+    for (size_t size : {1, 7, 4096, 4097, 100'000}) {
+        INFO("size = " << size);
+        CheckColumn(GenerateColumn<double>(size, rng));
+        CheckColumn(GenerateColumn<float>(size, rng));
+        CheckColumn(GenerateColumn<int32_t>(size, rng));
+        CheckColumn(GenerateColumn<int64_t>(size, rng));
+    }
+}
+
+TEST_CASE("VarianceIsStable") {
+    // Naive sum of squares loses everything here
+    std::vector<double> data(100'000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = 1e9 + static_cast<double>(i % 2);
+    }
+
+    Moments<double> moments;
+    ScanColumn(std::span<const double>{data}, moments);
+    CHECK(std::abs(moments.Mean() - (1e9 + 0.5)) < 1e-6);
+    CHECK(std::abs(moments.Variance() - 0.25) < 1e-6);
+}
+
+TEST_CASE("MappedColumn") {
+    char path[] = "/tmp/column-scan-XXXXXX";
+    int fd = mkstemp(path);
+    INTERNAL_ASSERT(fd != -1);
+
+    std::vector<int64_t> data(10'000);
+    std::iota(data.begin(), data.end(), -5000);
+    auto bytes = data.size() * sizeof(int64_t);
+    auto written = write(fd, data.data(), bytes);
+    INTERNAL_ASSERT(written == static_cast<ssize_t>(bytes));
+    close(fd);
+
+    {
+        MappedColumn<int64_t> column{path};
+        REQUIRE(column.Data().size() == data.size());
+
+        MinMax<int64_t> min_max;
+        Moments<int64_t> moments;
+        ScanColumn(column.Data(), min_max, moments);
+        CHECK(min_max.Min() == -5000);
+        CHECK(min_max.Max() == 4999);
+        CHECK(std::abs(moments.Mean() + 0.5) < 1e-9);
+    }
+
+    CHECK_THROWS(MappedColumn<double>{"/nonexistent/column"});
+
+    {
+        int ret = truncate(path, 3);
+        INTERNAL_ASSERT(ret == 0);
+        CHECK_THROWS(MappedColumn<int32_t>{path});
+    }
+
+    unlink(path);
+}
@@ -0,0 +1,123 @@
+#include "tree-layout.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Rewrites a binary tree file so that traversals touch it (mostly)
+// sequentially. The output has the same format and node count, the root stays
+// at index 0.
+
+namespace {
+
+struct Mapping {
+    void* data = MAP_FAILED;
+    size_t size = 0;
+
+    ~Mapping() {
+        if (data != MAP_FAILED) {
+            munmap(data, size);
+        }
+    }
+};
+
+int Fail(const char* what, const char* path) {
+    std::cerr << what << ' ' << path << ": " << std::strerror(errno)
+              << std::endl;
+    return 1;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    auto layout = TreeLayout::Preorder;
+    if (argc == 4) {
+        std::string_view arg = argv[3];
+        if (arg == "--layout=dfs") {
+            layout = TreeLayout::Preorder;
+        } else if (arg == "--layout=veb") {
+            layout = TreeLayout::VanEmdeBoas;
+        } else {
+            argc = 0;
+        }
+    }
+    if (argc != 3 && argc != 4) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <input> <output> [--layout=dfs|veb]" << std::endl;
+        return 1;
+    }
+
+    const char* input_path = argv[1];
+    const char* output_path = argv[2];
+
+    int in_fd = open(input_path, O_RDONLY);
+    if (in_fd == -1) {
+        return Fail("Failed to open", input_path);
+    }
+
+    struct stat st{};
+
+    if (fstat(in_fd, &st) == -1) {
+        close(in_fd);
+        return Fail("Failed to stat", input_path);
+    }
+    if (st.st_size % sizeof(Node) != 0) {
+        close(in_fd);
+        std::cerr << "File size is not a multiple of node size" << std::endl;
+        return 1;
+    }
+
+    Mapping input{.size = static_cast<size_t>(st.st_size)};
+    if (input.size != 0) {
+        input.data =
+            mmap(nullptr, input.size, PROT_READ, MAP_PRIVATE, in_fd, 0);
+    }
+    close(in_fd);
+    if (input.size != 0 && input.data == MAP_FAILED) {
+        return Fail("Failed to map", input_path);
+    }
+
+    std::span<const Node> nodes{static_cast<const Node*>(input.data),
+                                input.size / sizeof(Node)};
+    auto order = layout == TreeLayout::VanEmdeBoas ? VanEmdeBoasOrder(nodes)
+                                                   : PreorderOrder(nodes);
+    if (!order) {
+        std::cerr << "Input is not a valid tree" << std::endl;
+        return 1;
+    }
+
+    int out_fd = open(output_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (out_fd == -1) {
+        return Fail("Failed to open", output_path);
+    }
+    if (ftruncate(out_fd, st.st_size) == -1) {
+        close(out_fd);
+        return Fail("Failed to truncate", output_path);
+    }
+
+    Mapping output{.size = input.size};
+    if (output.size != 0) {
+        output.data = mmap(nullptr, output.size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, out_fd, 0);
+    }
+    if (output.size != 0 && output.data == MAP_FAILED) {
+        close(out_fd);
+        return Fail("Failed to map", output_path);
+    }
+
+    ApplyOrder(nodes, *order,
+               {static_cast<Node*>(output.data), nodes.size()});
+
+    if (output.size != 0 && msync(output.data, output.size, MS_SYNC) == -1) {
+        close(out_fd);
+        return Fail("Failed to sync", output_path);
+    }
+    if (close(out_fd) == -1) {
+        return Fail("Failed to close", output_path);
+    }
+}
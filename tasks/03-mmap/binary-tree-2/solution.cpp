@@ -1,25 +1,138 @@
+#include "tree-layout.hpp"
+
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <sys/fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <vector>
+
+class KeyPrinter {
+  public:
+    KeyPrinter() : buf_(kCapacity) {
+    }
+
+    KeyPrinter(const KeyPrinter&) = delete;
+    KeyPrinter& operator=(const KeyPrinter&) = delete;
+
+    // Appends key and a separator
+    void Print(int32_t key) {
+        if (size_ + kMaxKeyLength > buf_.size()) {
+            Flush();
+        }
+
+        char* out = buf_.data() + size_;
+        uint32_t value = static_cast<uint32_t>(key);
+        if (key < 0) {
+            *out++ = '-';
+            value = 0u - value;
+        }
+
+        // Digits are produced from the end, two at a time
+        char digits[10];
+        char* d = digits + sizeof(digits);
+        while (value >= 100) {
+            auto pair = (value % 100) * 2;
+            value /= 100;
+            *--d = kDigitPairs[pair + 1];
+            *--d = kDigitPairs[pair];
+        }
+        if (value >= 10) {
+            *--d = kDigitPairs[value * 2 + 1];
+            *--d = kDigitPairs[value * 2];
+        } else {
+            *--d = static_cast<char>('0' + value);
+        }
+
+        auto len = static_cast<size_t>(digits + sizeof(digits) - d);
+        std::memcpy(out, d, len);
+        out[len] = ' ';
+        size_ = static_cast<size_t>(out + len + 1 - buf_.data());
+    }
+
+    void Flush() {
+        std::cout.write(buf_.data(), static_cast<std::streamsize>(size_));
+        size_ = 0;
+    }
+
+    ~KeyPrinter() {
+        Flush();
+    }
+
+  private:
+    static constexpr size_t kCapacity = 1 << 20;
+    // "-2147483648 "
+    static constexpr size_t kMaxKeyLength = 12;
+
+    static constexpr char kDigitPairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
 
-struct Node {
-    int32_t key;
-    int32_t left_idx;
-    int32_t right_idx;
+    std::vector<char> buf_;
+    size_t size_ = 0;
 };
 
-void dfs(int32_t idx, const Node* buf) {
-    Node cur_node = buf[idx];
-    if (cur_node.right_idx != 0) {
-        dfs(cur_node.right_idx, buf);
+// Hints the cache to fetch a node we are going to visit later. Never faults,
+// so it is fine to prefetch the (fake) node 0 for missing children.
+inline void PrefetchNode(const Node* buf, int32_t idx) {
+    __builtin_prefetch(buf + idx, /* rw */ 0, /* locality */ 3);
+}
+
+// Reverse in-order traversal with an explicit stack, so degenerate trees can't
+// overflow the call stack. Children of a node are prefetched as soon as the
+// node itself is loaded: the right child is needed on the next step, while
+// the left one gets the whole right subtree as a lead time. Going further
+// down would need the indices stored in the children, i.e. waiting for the
+// very loads the prefetch is meant to hide.
+//
+// A tree visits every node once, so more visits than nodes means a cycle.
+bool Traverse(const Node* buf, size_t node_count, KeyPrinter& printer) {
+    std::vector<Node> stack;
+    stack.reserve(1024);
+    size_t visited = 0;
+
+    auto descend = [&](int32_t idx) {
+        while (true) {
+            if (idx < 0 || static_cast<size_t>(idx) >= node_count ||
+                visited == node_count) {
+                return false;
+            }
+            ++visited;
+            Node node = buf[idx];
+            PrefetchNode(buf, node.right_idx);
+            PrefetchNode(buf, node.left_idx);
+            stack.push_back(node);
+
+            if (node.right_idx == 0) {
+                return true;
+            }
+            idx = node.right_idx;
+        }
+    };
+
+    if (!descend(0)) {
+        return false;
     }
-    std::cout << cur_node.key << ' ';
-    if (cur_node.left_idx != 0) {
-        dfs(cur_node.left_idx, buf);
+    while (!stack.empty()) {
+        Node node = stack.back();
+        stack.pop_back();
+        printer.Print(node.key);
+        if (node.left_idx != 0 && !descend(node.left_idx)) {
+            return false;
+        }
     }
+    return true;
 }
 
 int main(int argc, char* argv[]) {
@@ -41,6 +154,12 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    const size_t node_count = st.st_size / sizeof(Node);
+    if (node_count == 0) {
+        std::cerr << "File " << argv[1] << " contains no nodes" << std::endl;
+        return 1;
+    }
+
     void* buf = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE,
                      static_cast<int>(fd), 0);
     if (buf == MAP_FAILED) {
@@ -49,7 +168,22 @@ int main(int argc, char* argv[]) {
     }
 
     const auto data = static_cast<const Node*>(buf);
-    dfs(0, data);
+
+    // Preorder files are walked front to back, otherwise keep the default
+    if (DetectLayout({data, node_count}) == TreeLayout::Preorder) {
+        madvise(buf, st.st_size, MADV_SEQUENTIAL);
+    }
+
+    bool ok;
+    {
+        KeyPrinter printer;
+        ok = Traverse(data, node_count, printer);
+    }
+    std::cout << '\n';
+    if (!ok) {
+        std::cerr << "File " << argv[1] << " is not a valid tree" << std::endl;
+        return 1;
+    }
 
     if (munmap(buf, st.st_size) == -1) {
         std::cerr << "Failed to unmap file " << argv[1] << std::endl;
@@ -0,0 +1,136 @@
+#include "tree-layout.hpp"
+
+#include <pcg-random.hpp>
+
+#include <catch2/catch_get_random_seed.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+// Random BST with nodes shuffled across the file, root at index 0
+std::vector<Node> GenerateTree(size_t size, PCGRandom& rng) {
+    std::vector<int32_t> position(size);
+    std::iota(position.begin(), position.end(), 0);
+    std::shuffle(position.begin() + 1, position.end(), rng);
+
+    std::vector<Node> nodes(size);
+    nodes[0] = {.key = static_cast<int32_t>(rng() % 1000), .left_idx = 0,
+                .right_idx = 0};
+    for (size_t i = 1; i < size; ++i) {
+        auto key = static_cast<int32_t>(rng() % 1000);
+        auto idx = position[i];
+        nodes[idx] = {.key = key, .left_idx = 0, .right_idx = 0};
+
+        int32_t cur = 0;
+        while (true) {
+            auto& link = key < nodes[cur].key ? nodes[cur].left_idx
+                                               : nodes[cur].right_idx;
+            if (link == 0) {
+                link = idx;
+                break;
+            }
+            cur = link;
+        }
+    }
+    return nodes;
+}
+
+std::vector<int32_t> ReverseInOrder(std::span<const Node> nodes) {
+    std::vector<int32_t> keys;
+    std::vector<int32_t> stack;
+    int32_t cur = 0;
+    bool root = true;
+    while (root || cur != 0 || !stack.empty()) {
+        while (root || cur != 0) {
+            root = false;
+            stack.push_back(cur);
+            cur = nodes[cur].right_idx;
+        }
+        keys.push_back(nodes[stack.back()].key);
+        cur = nodes[stack.back()].left_idx;
+        stack.pop_back();
+    }
+    return keys;
+}
+
+std::vector<Node> Relayout(std::span<const Node> nodes, TreeLayout layout) {
+    auto order = layout == TreeLayout::Preorder ? PreorderOrder(nodes)
+                                                : VanEmdeBoasOrder(nodes);
+    REQUIRE(order.has_value());
+    REQUIRE(order->size() <= nodes.size());
+
+    std::vector<Node> result(nodes.size());
+    ApplyOrder(nodes, *order, result);
+    return result;
+}
+
+TEST_CASE("Relayout") {
+    PCGRandom rng{Catch::getSeed()};
+    rng.Warmup();
+
+    for (size_t size : {1, 2, 10, 1000, 100'000}) {
+        INFO("size = " << size);
+        auto nodes = GenerateTree(size, rng);
+        auto keys = ReverseInOrder(nodes);
+
+        auto preorder = Relayout(nodes, TreeLayout::Preorder);
+        CHECK(ReverseInOrder(preorder) == keys);
+        CHECK(preorder[0].key == nodes[0].key);
+
+        auto veb = Relayout(nodes, TreeLayout::VanEmdeBoas);
+        CHECK(ReverseInOrder(veb) == keys);
+        CHECK(veb[0].key == nodes[0].key);
+
+        if (size > 1) {
+            CHECK(DetectLayout(preorder) == TreeLayout::Preorder);
+        }
+        if (size > 10) {
+            CHECK(DetectLayout(nodes) == TreeLayout::Unknown);
+        }
+    }
+}
+
+TEST_CASE("DegenerateTree") {
+    static constexpr int32_t kSize = 1'000'000;
+    std::vector<Node> nodes(kSize);
+    for (int32_t i = 0; i < kSize; ++i) {
+        nodes[i] = {.key = i, .left_idx = i + 1 < kSize ? i + 1 : 0,
+                    .right_idx = 0};
+    }
+
+    auto keys = ReverseInOrder(nodes);
+    CHECK(ReverseInOrder(Relayout(nodes, TreeLayout::Preorder)) == keys);
+    CHECK(ReverseInOrder(Relayout(nodes, TreeLayout::VanEmdeBoas)) == keys);
+}
+
+TEST_CASE("InvalidTree") {
+    std::vector<Node> cycle = {
+        {.key = 0, .left_idx = 1, .right_idx = 0},
+        {.key = 1, .left_idx = 2, .right_idx = 0},
+        {.key = 2, .left_idx = 1, .right_idx = 0},
+    };
+    CHECK_FALSE(PreorderOrder(cycle).has_value());
+    CHECK_FALSE(VanEmdeBoasOrder(cycle).has_value());
+
+    std::vector<Node> out_of_range = {
+        {.key = 0, .left_idx = 5, .right_idx = 0},
+    };
+    CHECK_FALSE(PreorderOrder(out_of_range).has_value());
+    CHECK_FALSE(VanEmdeBoasOrder(out_of_range).has_value());
+}
+
+TEST_CASE("UnreachableNodesAreKept") {
+    std::vector<Node> nodes = {
+        {.key = 5, .left_idx = 2, .right_idx = 0},
+        {.key = 100, .left_idx = 42, .right_idx = 0},
+        {.key = 3, .left_idx = 0, .right_idx = 0},
+    };
+
+    auto preorder = Relayout(nodes, TreeLayout::Preorder);
+    CHECK(ReverseInOrder(preorder) == std::vector<int32_t>{5, 3});
+    CHECK(preorder[2].key == 100);
+    CHECK(preorder[2].left_idx == 0);
+}
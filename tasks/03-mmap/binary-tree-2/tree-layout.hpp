@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+struct Node {
+    int32_t key;
+    int32_t left_idx;
+    int32_t right_idx;
+};
+
+// Order of the nodes in the file.
+//
+// Preorder: every node is followed by its right subtree and then by its left
+// subtree, i.e. nodes are stored in the same order a reverse in-order
+// traversal loads them, and the traversal reads the file front to back.
+//
+// VanEmdeBoas: the tree is cut at half of its height, the top part is stored
+// first and the bottom subtrees follow it, recursively. Any root-to-leaf path
+// of length h touches O(h / log B) blocks of size B, whatever B is.
+enum class TreeLayout {
+    Unknown,
+    Preorder,
+    VanEmdeBoas,
+};
+
+// Number of leading nodes DetectLayout looks at. Detection must stay cheap
+// for trees that do not fit in memory.
+inline constexpr size_t kLayoutSampleSize = 1024;
+
+// Checks that the given prefix of the file looks like a preorder layout: the
+// first child visited by the traversal of every node is stored right after
+// it. The prefix has to contain at least one inner node.
+inline bool IsPreorderPrefix(std::span<const Node> prefix) {
+    size_t checked = 0;
+    for (size_t i = 0; i < prefix.size(); ++i) {
+        auto next = prefix[i].right_idx != 0 ? prefix[i].right_idx
+                                             : prefix[i].left_idx;
+        if (next == 0) {
+            continue;
+        }
+        if (static_cast<size_t>(next) != i + 1) {
+            return false;
+        }
+        ++checked;
+    }
+    return checked > 0;
+}
+
+// Van Emde Boas layout has no local property which is cheap to check, so
+// only the preorder layout is detected
+inline TreeLayout DetectLayout(std::span<const Node> nodes) {
+    auto sample = std::min(nodes.size(), kLayoutSampleSize);
+    if (IsPreorderPrefix(nodes.first(sample))) {
+        return TreeLayout::Preorder;
+    }
+    return TreeLayout::Unknown;
+}
+
+namespace detail {
+
+inline bool IsValidChild(int32_t idx, size_t count) {
+    return idx > 0 && static_cast<size_t>(idx) < count;
+}
+
+// Traversal order for both layouts: right subtree goes first
+inline std::pair<int32_t, int32_t> Children(const Node& node) {
+    return {node.right_idx, node.left_idx};
+}
+
+}  // namespace detail
+
+// Returns the nodes reachable from the root in right-first preorder, nullopt
+// if some index is out of range or the nodes do not form a tree
+inline std::optional<std::vector<int32_t>> PreorderOrder(
+    std::span<const Node> nodes) {
+    std::vector<int32_t> order;
+    if (nodes.empty()) {
+        return order;
+    }
+
+    std::vector<bool> seen(nodes.size());
+    std::vector<int32_t> stack = {0};
+    while (!stack.empty()) {
+        auto idx = stack.back();
+        stack.pop_back();
+        if (seen[idx]) {
+            return std::nullopt;
+        }
+        seen[idx] = true;
+        order.push_back(idx);
+
+        auto [first, second] = detail::Children(nodes[idx]);
+        for (auto child : {second, first}) {
+            if (child == 0) {
+                continue;
+            }
+            if (!detail::IsValidChild(child, nodes.size())) {
+                return std::nullopt;
+            }
+            stack.push_back(child);
+        }
+    }
+    return order;
+}
+
+namespace detail {
+
+class VanEmdeBoasBuilder {
+  public:
+    explicit VanEmdeBoasBuilder(std::span<const Node> nodes) : nodes_{nodes} {
+    }
+
+    std::optional<std::vector<int32_t>> Build() {
+        if (nodes_.empty()) {
+            return std::move(order_);
+        }
+
+        auto height = Height();
+        if (!height) {
+            return std::nullopt;
+        }
+        Layout(0, *height);
+        return std::move(order_);
+    }
+
+  private:
+    // Also validates the tree. The explicit stack keeps degenerate trees
+    // from overflowing the call stack.
+    std::optional<size_t> Height() {
+        std::vector<bool> seen(nodes_.size());
+        std::vector<std::pair<int32_t, size_t>> stack = {{0, 1}};
+        size_t height = 0;
+        while (!stack.empty()) {
+            auto [idx, depth] = stack.back();
+            stack.pop_back();
+            if (seen[idx]) {
+                return std::nullopt;
+            }
+            seen[idx] = true;
+            height = std::max(height, depth);
+
+            for (auto child : {nodes_[idx].left_idx, nodes_[idx].right_idx}) {
+                if (child == 0) {
+                    continue;
+                }
+                if (!IsValidChild(child, nodes_.size())) {
+                    return std::nullopt;
+                }
+                stack.emplace_back(child, depth + 1);
+            }
+        }
+        return height;
+    }
+
+    // Appends nodes of the subtree rooted at `root` with depth < `height`.
+    // Recursion depth is O(log(height)).
+    void Layout(int32_t root, size_t height) {
+        if (height == 1) {
+            order_.push_back(root);
+            return;
+        }
+
+        auto top = height / 2;
+        Layout(root, top);
+
+        // Roots of the bottom subtrees in traversal order
+        std::vector<std::pair<int32_t, size_t>> stack = {{root, 0}};
+        while (!stack.empty()) {
+            auto [idx, depth] = stack.back();
+            stack.pop_back();
+            if (depth == top) {
+                Layout(idx, height - top);
+                continue;
+            }
+
+            auto [first, second] = Children(nodes_[idx]);
+            for (auto child : {second, first}) {
+                if (child != 0) {
+                    stack.emplace_back(child, depth + 1);
+                }
+            }
+        }
+    }
+
+    std::span<const Node> nodes_;
+    std::vector<int32_t> order_;
+};
+
+}  // namespace detail
+
+// Same as PreorderOrder, but in van Emde Boas order
+inline std::optional<std::vector<int32_t>> VanEmdeBoasOrder(
+    std::span<const Node> nodes) {
+    return detail::VanEmdeBoasBuilder{nodes}.Build();
+}
+
+// Writes nodes to `out` so that out[i] = nodes[order[i]] with child indices
+// remapped. Nodes missing from `order` (unreachable from the root) are
+// appended at the end in their original order, so the root stays at index 0
+// and the node count does not change.
+inline void ApplyOrder(std::span<const Node> nodes,
+                       std::span<const int32_t> order, std::span<Node> out) {
+    std::vector<int32_t> position(nodes.size(), -1);
+    int32_t next = 0;
+    for (auto idx : order) {
+        position[idx] = next++;
+    }
+    for (size_t idx = 0; idx < nodes.size(); ++idx) {
+        if (position[idx] == -1) {
+            position[idx] = next++;
+        }
+    }
+
+    // Unreachable nodes may contain garbage, such links are dropped
+    auto remap = [&position](int32_t idx) {
+        return detail::IsValidChild(idx, position.size()) ? position[idx] : 0;
+    };
+    for (size_t idx = 0; idx < nodes.size(); ++idx) {
+        out[position[idx]] = {
+            .key = nodes[idx].key,
+            .left_idx = remap(nodes[idx].left_idx),
+            .right_idx = remap(nodes[idx].right_idx),
+        };
+    }
+}
@@ -8,11 +8,10 @@ char* StrDup(const char* str) {
         return nullptr;
     }
 
-    char* ci = out;
-    while ((*ci = *str) != '\0') {
-        ci++, str++;
+    // The length is known, no need to look for the NUL again
+    for (size_t i = 0; i <= n; ++i) {
+        out[i] = str[i];
     }
-
     return out;
 }
 
@@ -0,0 +1,155 @@
+#include "c-strings.hpp"
+#include "str-arena.hpp"
+
+#include <benchmark/harness.hpp>
+#include <benchmark/run.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Compares the functions from no-alloc.cpp with glibc across string lengths.
+// Prints nanoseconds per call for both and the throughput of ours. Then
+// compares building and storing many short strings with malloc-based
+// AStrCat and StrDup against StrBuilder and StrInterner.
+
+namespace {
+
+constexpr size_t kLengths[] = {1,   7,    16,    31,     64,     255,
+                               1024, 4096, 65536, 1 << 20, 1 << 24};
+// Enough samples for a stable median while keeping the whole sweep short
+const BenchmarkOptions kOptions{
+    .sample_time = std::chrono::milliseconds{2},
+    .samples = 15,
+};
+
+// Median nanoseconds per call, also appended to BENCHMARK_JSON if it's set
+template <class F>
+double NanosPerCall(const std::string& name, F&& f) {
+    auto result = Measure(name, f, kOptions);
+    ReportJson(result);
+    return result.wall.median;
+}
+
+std::string Text(size_t length) {
+    std::string text;
+    for (size_t i = 0; i < length; ++i) {
+        text.push_back('a' + i % 23);
+    }
+    return text;
+}
+
+template <class Ours, class Glibc>
+void Report(const char* name, size_t length, Ours&& ours_f, Glibc&& glibc_f) {
+    const auto suffix = "/" + std::to_string(length);
+    const double ours = NanosPerCall(name + ("/ours" + suffix), ours_f);
+    const double glibc = NanosPerCall(name + ("/glibc" + suffix), glibc_f);
+    std::printf("%-8s %10zu %12.1f %12.1f %8.2f %10.2f\n", name, length, ours,
+                glibc, glibc / ours, length / ours);
+}
+
+void BenchAllocating() {
+    constexpr size_t kPieces = 10000;
+    constexpr size_t kStrings = 1 << 20;
+    constexpr size_t kDistinct = 1 << 12;
+
+    auto ms = [](const CPUTimer::Times& times) {
+        return std::chrono::duration<double, std::milli>(times.wall_time)
+            .count();
+    };
+
+    auto chain = Run([] {
+        char* result = StrDup("");
+        for (size_t i = 0; i < kPieces; ++i) {
+            char* next = AStrCat(result, "piece ");
+            Deallocate(result);
+            result = next;
+        }
+        const size_t size = StrLen(result);
+        Deallocate(result);
+        return size;
+    });
+    auto builder = Run([] {
+        StrArena arena;
+        StrBuilder builder{arena};
+        for (size_t i = 0; i < kPieces; ++i) {
+            builder.Append("piece ");
+        }
+        return builder.Size();
+    });
+    std::printf("\n%zu pieces: AStrCat %.2f ms, StrBuilder %.2f ms\n",
+                kPieces, ms(chain), ms(builder));
+
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < kDistinct; ++i) {
+        keys.push_back("section.key" + std::to_string(i));
+    }
+    auto dup = Run([&keys] {
+        std::vector<char*> copies;
+        copies.reserve(kStrings);
+        for (size_t i = 0; i < kStrings; ++i) {
+            copies.push_back(StrDup(keys[i % kDistinct].c_str()));
+        }
+        for (char* copy : copies) {
+            Deallocate(copy);
+        }
+        return copies.size();
+    });
+    auto intern = Run([&keys] {
+        StrInterner interner;
+        std::vector<const char*> copies;
+        copies.reserve(kStrings);
+        for (size_t i = 0; i < kStrings; ++i) {
+            copies.push_back(interner.Intern(keys[i % kDistinct].c_str()));
+        }
+        return interner.Bytes();
+    });
+    std::printf("%zu strings: StrDup %.2f ms, StrInterner %.2f ms\n",
+                kStrings, ms(dup), ms(intern));
+}
+
+}  // namespace
+
+int main() {
+    std::printf("%-8s %10s %12s %12s %8s %10s\n", "function", "length",
+                "ours, ns", "glibc, ns", "speedup", "GB/s");
+
+    for (size_t length : kLengths) {
+        auto text = Text(length);
+        // Not in the alphabet of Text, so the needle is found at the end only
+        text.back() = 'z';
+        const auto copy = text;
+        const char* s = text.c_str();
+        const char* t = copy.c_str();
+        const auto needle = text.substr(length - std::min<size_t>(length, 8));
+        const char* n = needle.c_str();
+        std::vector<char> buffer(length + 1);
+
+        Report("strlen", length, [s] { return StrLen(s); },
+               [s] { return std::strlen(s); });
+        Report("strnlen", length, [s, length] { return StrNLen(s, length); },
+               [s, length] { return strnlen(s, length); });
+        Report("strcmp", length, [s, t] { return StrCmp(s, t); },
+               [s, t] { return std::strcmp(s, t); });
+        Report("strncmp", length,
+               [s, t, length] { return StrNCmp(s, t, length); },
+               [s, t, length] { return std::strncmp(s, t, length); });
+        Report(
+            "strcat", length,
+            [&] {
+                buffer[0] = '\0';
+                return StrCat(buffer.data(), s);
+            },
+            [&] {
+                buffer[0] = '\0';
+                return std::strcat(buffer.data(), s);
+            });
+        Report("strstr", length, [s, n] { return StrStr(s, n); },
+               [s, n] { return std::strstr(s, n); });
+    }
+
+    BenchAllocating();
+}
@@ -1,62 +1,350 @@
 #include "c-strings.hpp"
 
-#include <unused.hpp>  // TODO: remove before flight.
+#include <algorithm>
+#include <cstdint>
 
-size_t StrLen(const char* str) {
-    const char* end = str;
-    while (*end) {
-        end++;
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Strings are processed by blocks: 32 bytes with AVX2 when the build targets
+// it, 16 bytes with SSE2 on other x86-64 builds and 8 bytes in a general
+// purpose register (SWAR) elsewhere. Comparisons of blocks return masks with
+// bit i set for byte i.
+//
+// Blocks may extend past the terminating NUL, but they never cross into the
+// next page unless the string itself does, so reading them can't fault. ASan
+// doesn't know that, so such functions are not instrumented.
+
+#define PAGE_SAFE_READS __attribute__((no_sanitize_address))
+
+namespace {
+
+constexpr uintptr_t kPageSize = 4096;
+
+#if defined(__AVX2__)
+
+using Block = __m256i;
+constexpr size_t kBlockSize = 32;
+
+PAGE_SAFE_READS Block Load(const char* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+void Store(char* p, Block block) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), block);
+}
+
+Block Splat(char c) {
+    return _mm256_set1_epi8(c);
+}
+
+uint32_t EqualBytes(Block lhs, Block rhs) {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(lhs, rhs));
+}
+
+// Whether any of the four blocks at p has a zero byte
+PAGE_SAFE_READS bool HasZero4(const char* p) {
+    const __m256i min = _mm256_min_epu8(
+        _mm256_min_epu8(Load(p), Load(p + kBlockSize)),
+        _mm256_min_epu8(Load(p + 2 * kBlockSize), Load(p + 3 * kBlockSize)));
+    return !_mm256_testz_si256(_mm256_cmpeq_epi8(min, Splat('\0')),
+                               _mm256_set1_epi8(-1));
+}
+
+#elif defined(__x86_64__)
+
+using Block = __m128i;
+constexpr size_t kBlockSize = 16;
+
+PAGE_SAFE_READS Block Load(const char* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+void Store(char* p, Block block) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), block);
+}
+
+Block Splat(char c) {
+    return _mm_set1_epi8(c);
+}
+
+uint32_t EqualBytes(Block lhs, Block rhs) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs));
+}
+
+// Whether any of the four blocks at p has a zero byte
+PAGE_SAFE_READS bool HasZero4(const char* p) {
+    const __m128i min =
+        _mm_min_epu8(_mm_min_epu8(Load(p), Load(p + kBlockSize)),
+                     _mm_min_epu8(Load(p + 2 * kBlockSize),
+                                  Load(p + 3 * kBlockSize)));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(min, Splat('\0'))) != 0;
+}
+
+#else
+
+using Block = uint64_t;
+using UnalignedBlock = uint64_t __attribute__((may_alias, aligned(1)));
+constexpr size_t kBlockSize = 8;
+
+constexpr uint64_t kLowBits = 0x0101010101010101;
+constexpr uint64_t kHighBits = 0x8080808080808080;
+
+PAGE_SAFE_READS Block Load(const char* p) {
+    return *reinterpret_cast<const UnalignedBlock*>(p);
+}
+
+void Store(char* p, Block block) {
+    *reinterpret_cast<UnalignedBlock*>(p) = block;
+}
+
+Block Splat(char c) {
+    return kLowBits * static_cast<unsigned char>(c);
+}
+
+// Exact for every byte: the addition can't carry into the next one
+uint32_t EqualBytes(Block lhs, Block rhs) {
+    const uint64_t diff = lhs ^ rhs;
+    const uint64_t zeros =
+        ~(((diff & ~kHighBits) + ~kHighBits) | diff) & kHighBits;
+    // Gathers the high bits of all bytes in the top byte (little-endian)
+    return ((zeros >> 7) * 0x0102040810204080) >> 56;
+}
+
+// Whether any of the four blocks at p has a zero byte. The cheap test has
+// false positives, but only in words with a real zero byte.
+PAGE_SAFE_READS bool HasZero4(const char* p) {
+    uint64_t any = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        const Block block = Load(p + i * kBlockSize);
+        any |= (block - kLowBits) & ~block;
+    }
+    return (any & kHighBits) != 0;
+}
+
+#endif
+
+constexpr uint32_t kAllBytes =
+    kBlockSize == 32 ? ~uint32_t{0} : (uint32_t{1} << kBlockSize) - 1;
+
+uint32_t ZeroBytes(Block block) {
+    return EqualBytes(block, Splat('\0'));
+}
+
+// Whether a block read at p stays within one page
+bool FitsInPage(const char* p) {
+    return (reinterpret_cast<uintptr_t>(p) & (kPageSize - 1)) <=
+           kPageSize - kBlockSize;
+}
+
+const char* AlignDown(const char* p) {
+    return reinterpret_cast<const char*>(reinterpret_cast<uintptr_t>(p) &
+                                         ~(kBlockSize - 1));
+}
+
+// Number of whole blocks which can be read at p without leaving its page
+size_t BlocksInPage(const char* p) {
+    const uintptr_t offset = reinterpret_cast<uintptr_t>(p) & (kPageSize - 1);
+    return (kPageSize - offset) / kBlockSize;
+}
+
+int Diff(char lhs, char rhs) {
+    return static_cast<int>(lhs) - static_cast<int>(rhs);
+}
+
+}  // namespace
+
+PAGE_SAFE_READS size_t StrLen(const char* str) {
+    // Aligned blocks never cross pages. Bytes of the first block before str
+    // are shifted out of the mask.
+    const char* block = AlignDown(str);
+    const uint32_t zeros = ZeroBytes(Load(block)) >> (str - block);
+    if (zeros != 0) {
+        return __builtin_ctz(zeros);
+    }
+    block += kBlockSize;
+
+    // Groups of four blocks aligned to their size don't cross pages either,
+    // long strings are scanned by groups
+    constexpr uintptr_t kGroupMask = 4 * kBlockSize - 1;
+    while (true) {
+        if ((reinterpret_cast<uintptr_t>(block) & kGroupMask) == 0) {
+            while (!HasZero4(block)) {
+                block += 4 * kBlockSize;
+            }
+        }
+        const uint32_t zeros = ZeroBytes(Load(block));
+        if (zeros != 0) {
+            return static_cast<size_t>(block - str) + __builtin_ctz(zeros);
+        }
+        block += kBlockSize;
     }
-    return static_cast<size_t>(end - str);
 }
 
-size_t StrNLen(const char* str, size_t limit) {
-    const char* end = str;
-    while (*end && static_cast<size_t>(end - str) < limit) {
-        end++;
+PAGE_SAFE_READS size_t StrNLen(const char* str, size_t limit) {
+    if (limit == 0) {
+        return 0;
+    }
+
+    // Only blocks starting before str + limit are read
+    const char* block = AlignDown(str);
+    const uint32_t zeros = ZeroBytes(Load(block)) >> (str - block);
+    if (zeros != 0) {
+        const size_t len = __builtin_ctz(zeros);
+        return len < limit ? len : limit;
+    }
+    size_t scanned = kBlockSize - (str - block);
+    while (scanned < limit) {
+        block += kBlockSize;
+        const uint32_t zeros = ZeroBytes(Load(block));
+        if (zeros != 0) {
+            const size_t len = scanned + __builtin_ctz(zeros);
+            return len < limit ? len : limit;
+        }
+        scanned += kBlockSize;
     }
-    return static_cast<size_t>(end - str);
+    return limit;
 }
 
-int StrCmp(const char* lhs, const char* rhs) {
-    while (*lhs == *rhs) {
-        if (*lhs == '\0') {
-            return 0;
+PAGE_SAFE_READS int StrCmp(const char* lhs, const char* rhs) {
+    while (true) {
+        // Blocks up to the closest page end of the two strings
+        for (size_t blocks = std::min(BlocksInPage(lhs), BlocksInPage(rhs));
+             blocks > 0; --blocks) {
+            const Block left = Load(lhs);
+            const Block right = Load(rhs);
+            // The first difference or the end of both strings
+            const uint32_t stop =
+                (~EqualBytes(left, right) | ZeroBytes(left)) & kAllBytes;
+            if (stop != 0) {
+                const auto i = __builtin_ctz(stop);
+                return Diff(lhs[i], rhs[i]);
+            }
+            lhs += kBlockSize;
+            rhs += kBlockSize;
+        }
+
+        // Close to the end of a page, one byte at a time
+        for (size_t i = 0; i < kBlockSize; ++i) {
+            if (*lhs != *rhs || *lhs == '\0') {
+                return Diff(*lhs, *rhs);
+            }
+            lhs++, rhs++;
         }
-        lhs++, rhs++;
     }
-    return static_cast<int>(*lhs) - static_cast<int>(*rhs);
 }
 
-int StrNCmp(const char* lhs, const char* rhs, size_t limit) {
-    while (limit--) {
-        if (*lhs != *rhs) {
-            return static_cast<int>(*lhs) - static_cast<int>(*rhs);
+PAGE_SAFE_READS int StrNCmp(const char* lhs, const char* rhs, size_t limit) {
+    while (limit > 0) {
+        for (size_t blocks = std::min(BlocksInPage(lhs), BlocksInPage(rhs));
+             blocks > 0; --blocks) {
+            const Block left = Load(lhs);
+            const Block right = Load(rhs);
+            uint32_t stop =
+                (~EqualBytes(left, right) | ZeroBytes(left)) & kAllBytes;
+            if (limit < kBlockSize) {
+                stop &= (uint32_t{1} << limit) - 1;
+            }
+            if (stop != 0) {
+                const auto i = __builtin_ctz(stop);
+                return Diff(lhs[i], rhs[i]);
+            }
+            if (limit <= kBlockSize) {
+                return 0;
+            }
+            lhs += kBlockSize;
+            rhs += kBlockSize;
+            limit -= kBlockSize;
         }
-        if (*lhs == '\0') {
-            return 0;
+
+        for (size_t i = 0; i < kBlockSize && limit > 0; ++i) {
+            if (*lhs != *rhs || *lhs == '\0') {
+                return Diff(*lhs, *rhs);
+            }
+            lhs++, rhs++, limit--;
         }
-        lhs++, rhs++;
     }
     return 0;
 }
 
-char* StrCat(char* s1, const char* s2) {
+PAGE_SAFE_READS char* StrCat(char* s1, const char* s2) {
     char* p = s1 + StrLen(s1);
-    while ((*p++ = *s2++) != '\0') {
+    while (true) {
+        for (size_t blocks = BlocksInPage(s2); blocks > 0; --blocks) {
+            const Block block = Load(s2);
+            const uint32_t zeros = ZeroBytes(block);
+            if (zeros != 0) {
+                // The last block is copied up to the NUL inclusive
+                for (int i = 0; i <= __builtin_ctz(zeros); ++i) {
+                    p[i] = s2[i];
+                }
+                return s1;
+            }
+            Store(p, block);
+            p += kBlockSize;
+            s2 += kBlockSize;
+        }
+
+        for (size_t i = 0; i < kBlockSize; ++i) {
+            if ((*p++ = *s2++) == '\0') {
+                return s1;
+            }
+        }
     }
-    return s1;
 }
 
-const char* StrStr(const char* haystack, const char* needle) {
+// Candidate positions are those where both the first and the last bytes of
+// the needle match, the bytes in between are compared for them only
+PAGE_SAFE_READS const char* StrStr(const char* haystack, const char* needle) {
     if (*needle == '\0') {
         return haystack;
     }
-    size_t needle_len = StrLen(needle);
-    for (int i = 0; haystack[i] != '\0'; i++) {
-        if (StrNCmp(haystack + i, needle, needle_len) == 0) {
-            return haystack + i;
+    const size_t needle_len = StrLen(needle);
+    if (StrNLen(haystack, needle_len) < needle_len) {
+        return nullptr;
+    }
+
+    auto middle_matches = [needle, needle_len](const char* candidate) {
+        return needle_len <= 2 ||
+               StrNCmp(candidate + 1, needle + 1, needle_len - 2) == 0;
+    };
+
+    const Block first = Splat(needle[0]);
+    const Block last = Splat(needle[needle_len - 1]);
+    // Bytes from haystack to tail are known to be non-NUL, so the block at
+    // haystack is safe to read whenever the one at tail is
+    for (const char* tail = haystack + needle_len - 1;;) {
+        if (!FitsInPage(tail)) {
+            if (*tail == '\0') {
+                return nullptr;
+            }
+            if (*haystack == needle[0] && *tail == needle[needle_len - 1] &&
+                middle_matches(haystack)) {
+                return haystack;
+            }
+            ++haystack, ++tail;
+            continue;
+        }
+
+        const Block tail_block = Load(tail);
+        const uint32_t zeros = ZeroBytes(tail_block);
+        uint32_t candidates = EqualBytes(Load(haystack), first) &
+                              EqualBytes(tail_block, last);
+        if (zeros != 0) {
+            // Only the positions before the end of the haystack
+            candidates &= (zeros & -zeros) - 1;
+        }
+        for (; candidates != 0; candidates &= candidates - 1) {
+            const char* candidate = haystack + __builtin_ctz(candidates);
+            if (middle_matches(candidate)) {
+                return candidate;
+            }
+        }
+        if (zeros != 0) {
+            return nullptr;
         }
+        haystack += kBlockSize;
+        tail += kBlockSize;
     }
-    return nullptr;
 }
@@ -0,0 +1,185 @@
+#include "str-arena.hpp"
+#include "c-strings.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+#include <utility>
+
+namespace {
+
+constexpr size_t kMinCapacity = 16;
+constexpr size_t kMinSlots = 64;
+
+void* MapAnonymous(size_t size, int flags = 0) {
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    if (p == MAP_FAILED) {
+        throw std::bad_alloc{};
+    }
+    return p;
+}
+
+uint64_t LoadWord(const char* p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+uint64_t Mix(uint64_t h) {
+    h ^= h >> 32;
+    h *= 0xd6e8feb86659fd93;
+    h ^= h >> 32;
+    return h;
+}
+
+// Word at a time: config keys and values are mostly a few words long
+uint64_t HashBytes(const char* str, size_t size) {
+    uint64_t h = size * 0x9e3779b97f4a7c15;
+    for (; size >= 8; str += 8, size -= 8) {
+        h = Mix(h ^ LoadWord(str));
+    }
+    uint64_t tail = 0;
+    for (size_t i = 0; i < size; ++i) {
+        tail |= uint64_t{static_cast<unsigned char>(str[i])} << (8 * i);
+    }
+    return Mix(h ^ tail);
+}
+
+}  // namespace
+
+StrArena::StrArena(size_t chunk_size) : chunk_size_{chunk_size} {
+}
+
+StrArena::~StrArena() {
+    while (last_ != nullptr) {
+        Chunk* chunk = std::exchange(last_, last_->prev);
+        munmap(chunk, chunk->size);
+    }
+}
+
+char* StrArena::Allocate(size_t size) {
+    if (static_cast<size_t>(end_ - current_) < size) {
+        const size_t chunk_size = std::max(chunk_size_, sizeof(Chunk) + size);
+        auto chunk = static_cast<Chunk*>(MapAnonymous(chunk_size));
+        *chunk = {.prev = last_, .size = chunk_size};
+        last_ = chunk;
+        current_ = reinterpret_cast<char*>(chunk + 1);
+        end_ = reinterpret_cast<char*>(chunk) + chunk_size;
+        capacity_ += chunk_size;
+    }
+    return std::exchange(current_, current_ + size);
+}
+
+bool StrArena::TryResize(char* p, size_t old_size, size_t new_size) {
+    if (p + old_size != current_ ||
+        static_cast<size_t>(end_ - p) < new_size) {
+        return false;
+    }
+    current_ = p + new_size;
+    return true;
+}
+
+void StrBuilder::Reserve(size_t size) {
+    if (size <= capacity_) {
+        return;
+    }
+    const size_t capacity = std::max({size, 2 * capacity_, kMinCapacity});
+    if (data_ != nullptr && arena_.TryResize(data_, capacity_, capacity)) {
+        capacity_ = capacity;
+        return;
+    }
+    char* data = arena_.Allocate(capacity);
+    std::copy_n(data_, size_, data);
+    data_ = data;
+    capacity_ = capacity;
+}
+
+StrBuilder& StrBuilder::Append(const char* str, size_t size) {
+    Reserve(size_ + size + 1);
+    std::copy_n(str, size, data_ + size_);
+    size_ += size;
+    data_[size_] = '\0';
+    return *this;
+}
+
+StrBuilder& StrBuilder::Append(const char* str) {
+    return Append(str, StrLen(str));
+}
+
+StrBuilder& StrBuilder::Append(char c) {
+    return Append(&c, 1);
+}
+
+const char* StrBuilder::Finish() {
+    const char* result = CStr();
+    // Gives the unused tail of the buffer back unless something was
+    // allocated after it
+    if (data_ != nullptr) {
+        arena_.TryResize(data_, capacity_, size_ + 1);
+    }
+    data_ = nullptr;
+    size_ = capacity_ = 0;
+    return result;
+}
+
+StrInterner::StrInterner(size_t capacity)
+    : region_{static_cast<char*>(MapAnonymous(capacity, MAP_NORESERVE))},
+      current_{region_},
+      capacity_{capacity},
+      slots_(kMinSlots) {
+}
+
+StrInterner::~StrInterner() {
+    munmap(region_, capacity_);
+}
+
+const char* StrInterner::Intern(const char* str, size_t size) {
+    const auto hash = static_cast<uint32_t>(HashBytes(str, size));
+    const size_t mask = slots_.size() - 1;
+    size_t i = hash & mask;
+    for (; slots_[i].str != nullptr; i = (i + 1) & mask) {
+        const Slot& slot = slots_[i];
+        if (slot.hash == hash && slot.size == size &&
+            std::equal(str, str + size, slot.str)) {
+            return slot.str;
+        }
+    }
+
+    if (size >= UINT32_MAX ||
+        static_cast<size_t>(region_ + capacity_ - current_) < size + 1) {
+        throw std::bad_alloc{};
+    }
+    char* copy = current_;
+    std::copy_n(str, size, copy);
+    copy[size] = '\0';
+    current_ += size + 1;
+
+    slots_[i] = {.str = copy, .size = static_cast<uint32_t>(size),
+                 .hash = hash};
+    if (2 * ++size_ > slots_.size()) {
+        Grow();
+    }
+    return copy;
+}
+
+const char* StrInterner::Intern(const char* str) {
+    return Intern(str, StrLen(str));
+}
+
+void StrInterner::Grow() {
+    std::vector<Slot> slots(2 * slots_.size());
+    const size_t mask = slots.size() - 1;
+    for (const Slot& slot : slots_) {
+        if (slot.str == nullptr) {
+            continue;
+        }
+        size_t i = slot.hash & mask;
+        while (slots[i].str != nullptr) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+    slots_ = std::move(slots);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bump allocator over mmapped chunks. Memory is never freed one allocation
+// at a time: everything allocated from the arena lives until it's destroyed.
+class StrArena {
+  public:
+    static constexpr size_t kDefaultChunkSize = 1 << 20;
+
+    explicit StrArena(size_t chunk_size = kDefaultChunkSize);
+
+    StrArena(const StrArena&) = delete;
+    StrArena& operator=(const StrArena&) = delete;
+
+    ~StrArena();
+
+    // Throws std::bad_alloc if there is no memory left
+    char* Allocate(size_t size);
+
+    // Resizes the allocation at p of old_size bytes in place. Possible only
+    // for the last allocation and while it fits in the current chunk.
+    bool TryResize(char* p, size_t old_size, size_t new_size);
+
+    // Bytes mapped by the arena
+    size_t Capacity() const {
+        return capacity_;
+    }
+
+  private:
+    // Chunks are linked through a header at their beginning
+    struct Chunk {
+        Chunk* prev;
+        size_t size;
+    };
+
+    size_t chunk_size_;
+    Chunk* last_ = nullptr;
+    char* current_ = nullptr;
+    char* end_ = nullptr;
+    size_t capacity_ = 0;
+};
+
+// Concatenates pieces into a NUL-terminated string allocated from an arena.
+// The buffer grows geometrically, in place when it's the last allocation of
+// the arena, so n appended bytes cost O(n) in total. Buffers left behind by
+// growing take at most as much memory as the final string.
+class StrBuilder {
+  public:
+    explicit StrBuilder(StrArena& arena) : arena_{arena} {
+    }
+
+    StrBuilder& Append(const char* str, size_t size);
+    StrBuilder& Append(const char* str);
+    StrBuilder& Append(char c);
+
+    size_t Size() const {
+        return size_;
+    }
+
+    // Valid until the next Append
+    const char* CStr() const {
+        return data_ == nullptr ? "" : data_;
+    }
+
+    // Returns the built string, which stays valid as long as the arena, and
+    // starts a new one
+    const char* Finish();
+
+  private:
+    void Reserve(size_t size);
+
+    StrArena& arena_;
+    char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
+
+// Stores a single copy of every distinct string. The copies live in one
+// reserved mmapped region which is never moved, so the returned pointers
+// are stable and equal strings are interned to equal pointers. The kernel
+// backs the region with memory only as it's filled.
+class StrInterner {
+  public:
+    static constexpr size_t kDefaultCapacity = size_t{1} << 32;
+
+    // Reserves capacity bytes of address space for the strings
+    explicit StrInterner(size_t capacity = kDefaultCapacity);
+
+    StrInterner(const StrInterner&) = delete;
+    StrInterner& operator=(const StrInterner&) = delete;
+
+    ~StrInterner();
+
+    // Throws std::bad_alloc when the region is exhausted
+    const char* Intern(const char* str, size_t size);
+    const char* Intern(const char* str);
+
+    // Number of distinct strings
+    size_t Size() const {
+        return size_;
+    }
+
+    // Bytes of the region taken by the strings and their NULs
+    size_t Bytes() const {
+        return static_cast<size_t>(current_ - region_);
+    }
+
+  private:
+    struct Slot {
+        const char* str = nullptr;
+        uint32_t size = 0;
+        uint32_t hash = 0;
+    };
+
+    void Grow();
+
+    char* region_ = nullptr;
+    char* current_ = nullptr;
+    size_t capacity_ = 0;
+
+    // Open addressing with linear probing, at most half full
+    std::vector<Slot> slots_;
+    size_t size_ = 0;
+};
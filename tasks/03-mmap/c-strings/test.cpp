@@ -1,12 +1,23 @@
 #include "c-strings.hpp"
+#include "str-arena.hpp"
 
 #include <benchmark/run.hpp>
 #include <bit>
 #include <defer.hpp>
-#include <bit>
+#include <internal-assert.hpp>
+#include <pcg-random.hpp>
 
+#include <catch2/catch_get_random_seed.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <cstring>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
 using namespace std::chrono_literals;
 
 TEST_CASE("NonAlloc") {
@@ -105,6 +116,78 @@ TEST_CASE("NonAlloc") {
     }
 }
 
+int Sign(int value) {
+    return (value > 0) - (value < 0);
+}
+
+std::string RandomString(PCGRandom& rng, size_t length) {
+    std::string str;
+    for (size_t i = 0; i < length; ++i) {
+        str += static_cast<char>('a' + rng() % 3);
+    }
+    return str;
+}
+
+// Strings which end right before an inaccessible page, block reads past them
+// would fault
+TEST_CASE("PageBoundaries") {
+    const size_t page = sysconf(_SC_PAGESIZE);
+    auto* mapping =
+        static_cast<char*>(mmap(nullptr, 2 * page, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    INTERNAL_ASSERT(mapping != MAP_FAILED);
+    Defer cleanup([mapping, page] { munmap(mapping, 2 * page); });
+    INTERNAL_ASSERT(mprotect(mapping + page, page, PROT_NONE) == 0);
+
+    // Copies str to the end of the first page
+    auto place = [&](const std::string& str) {
+        char* dst = mapping + page - str.size() - 1;
+        std::memcpy(dst, str.c_str(), str.size() + 1);
+        return dst;
+    };
+
+    PCGRandom rng{Catch::getSeed()};
+    char buffer[256];
+    for (size_t length = 0; length < 100; ++length) {
+        INFO("length = " << length);
+        const auto str = RandomString(rng, length);
+        const char* placed = place(str);
+        CHECK(StrLen(placed) == length);
+        CHECK(StrNLen(placed, length / 2) == length / 2);
+        CHECK(StrNLen(placed, length + 10) == length);
+
+        auto other = str;
+        if (length > 0) {
+            other[rng() % length] = 'd';
+        }
+        for (size_t limit : {length / 2, length, length + 1}) {
+            CHECK(Sign(StrNCmp(placed, other.c_str(), limit)) ==
+                  Sign(std::strncmp(str.c_str(), other.c_str(), limit)));
+        }
+        CHECK(Sign(StrCmp(placed, other.c_str())) ==
+              Sign(std::strcmp(str.c_str(), other.c_str())));
+        CHECK(StrCmp(placed, str.c_str()) == 0);
+
+        buffer[0] = '\0';
+        CHECK(StrCmp(StrCat(buffer, placed), str.c_str()) == 0);
+
+        for (int i = 0; i < 10; ++i) {
+            const auto needle = RandomString(rng, rng() % 6);
+            const char* expected = std::strstr(str.c_str(), needle.c_str());
+            const char* found = StrStr(placed, needle.c_str());
+            INFO("haystack = " << str << ", needle = " << needle);
+            REQUIRE((found == nullptr) == (expected == nullptr));
+            if (found) {
+                CHECK(found - placed == expected - str.c_str());
+            }
+        }
+        // Needles at the end of the page as well
+        const auto needle = str.substr(rng() % (length + 1));
+        const char* found = StrStr(str.c_str(), place(needle));
+        CHECK(found == std::strstr(str.c_str(), needle.c_str()));
+    }
+}
+
 TEST_CASE("StrDup") {
     // Preserves callsite
 #define CHECK_STR(s)                                                           \
@@ -188,3 +271,70 @@ TEST_CASE("AStrCat") {
 
 #undef CHECK_STRS
 }
+
+TEST_CASE("StrBuilder") {
+    StrArena arena{4096};
+    StrBuilder builder{arena};
+    CHECK(StrCmp(builder.CStr(), "") == 0);
+
+    builder.Append("aba").Append('c').Append("abad", 3);
+    CHECK(builder.Size() == 7);
+    CHECK(StrCmp(builder.CStr(), "abacaba") == 0);
+    const char* first = builder.Finish();
+    CHECK(builder.Size() == 0);
+
+    // Outgrows the chunks several times, the first string stays intact
+    PCGRandom rng{Catch::getSeed()};
+    std::string expected;
+    for (int i = 0; i < 10000; ++i) {
+        auto piece = RandomString(rng, rng() % 20);
+        builder.Append(piece.c_str());
+        expected += piece;
+    }
+    const char* second = builder.Finish();
+    CHECK(second == expected);
+    CHECK(StrCmp(first, "abacaba") == 0);
+    // The buffers left behind by growing are bounded by the final size
+    CHECK(arena.Capacity() <= 4 * expected.size() + 4096);
+
+    SECTION("Performance") {
+        StrArena big_arena;
+        auto times = Run([&big_arena] {
+            StrBuilder builder{big_arena};
+            for (size_t i = 0; i < (1 << 20); ++i) {
+                builder.Append("abacaba");
+            }
+            REQUIRE(builder.Size() == 7 << 20);
+            return builder.Finish();
+        });
+        CHECK(times.TotalCpuTime() < 500ms);
+    }
+}
+
+TEST_CASE("StrInterner") {
+    StrInterner interner{1 << 24};
+    const char* aba = interner.Intern("aba");
+    CHECK(StrCmp(aba, "aba") == 0);
+    CHECK(interner.Intern(std::string{"aba"}.c_str()) == aba);
+    CHECK(interner.Intern("abacaba", 3) == aba);
+    CHECK(interner.Intern("ab") != aba);
+    CHECK(interner.Intern("") == interner.Intern("", 0));
+    CHECK(interner.Size() == 3);
+
+    // Pointers stay valid while the table grows
+    PCGRandom rng{Catch::getSeed()};
+    std::vector<std::pair<std::string, const char*>> interned;
+    for (int i = 0; i < 100000; ++i) {
+        auto str = RandomString(rng, rng() % 12);
+        interned.emplace_back(str, interner.Intern(str.c_str()));
+    }
+    for (const auto& [str, ptr] : interned) {
+        REQUIRE(StrCmp(ptr, str.c_str()) == 0);
+        REQUIRE(interner.Intern(str.c_str(), str.size()) == ptr);
+    }
+    CHECK(interner.Intern("aba") == aba);
+
+    StrInterner small{16};
+    small.Intern("0123456789");
+    CHECK_THROWS_AS(small.Intern("abacaba"), std::bad_alloc);
+}
@@ -0,0 +1,212 @@
+#include "spiral.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <limits>
+#include <string_view>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Generates large spiral matrices (same output as the solution). The matrix
+// is split into tiles of consecutive cells which are filled in parallel, each
+// tile in row-major order. Tiles are stored either directly into a shared
+// mapping or from a per-thread buffer with pwrite.
+
+namespace {
+
+struct Options {
+    const char* path = nullptr;
+    uint64_t rows = 0;
+    uint64_t cols = 0;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t tile_cells = uint64_t{1} << 20;
+    bool use_pwrite = false;
+};
+
+template <class T>
+bool ParseNumber(std::string_view str, T& value) {
+    const char* end = str.data() + str.size();
+    auto [ptr, ec] = std::from_chars(str.data(), end, value);
+    return ec == std::errc{} && ptr == end && value > 0;
+}
+
+bool ParseOptions(int argc, char* argv[], Options& options) {
+    std::vector<std::string_view> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--pwrite") {
+            options.use_pwrite = true;
+        } else if (arg.starts_with("--threads=")) {
+            if (!ParseNumber(arg.substr(10), options.threads)) {
+                return false;
+            }
+        } else if (arg.starts_with("--tile-cells=")) {
+            if (!ParseNumber(arg.substr(13), options.tile_cells)) {
+                return false;
+            }
+        } else if (arg.starts_with("--")) {
+            return false;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() != 3) {
+        return false;
+    }
+    options.path = positional[0].data();
+    return ParseNumber(positional[1], options.rows) &&
+           ParseNumber(positional[2], options.cols);
+}
+
+bool PWriteAll(int fd, const char* buf, size_t count, off_t off) {
+    while (count > 0) {
+        ssize_t ret = pwrite(fd, buf, count, off);
+        if (ret == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buf += ret;
+        count -= static_cast<size_t>(ret);
+        off += ret;
+    }
+    return true;
+}
+
+class Generator {
+  public:
+    Generator(const Options& options, int fd, int32_t* map)
+        : options_{options},
+          fd_{fd},
+          map_{map},
+          cells_{options.rows * options.cols},
+          tiles_{(cells_ + options.tile_cells - 1) / options.tile_cells} {
+    }
+
+    // Returns 0 on success, errno of the first failed pwrite otherwise
+    int Run() {
+        auto threads = std::min<uint64_t>(options_.threads, tiles_);
+        std::vector<std::thread> workers;
+        for (uint64_t i = 1; i < threads; ++i) {
+            workers.emplace_back([this] { Work(); });
+        }
+        Work();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        return error_.load();
+    }
+
+  private:
+    void Work() {
+        std::vector<int32_t> buffer;
+        if (options_.use_pwrite) {
+            buffer.resize(std::min(options_.tile_cells, cells_));
+        }
+
+        while (error_.load(std::memory_order_relaxed) == 0) {
+            auto tile = next_tile_.fetch_add(1, std::memory_order_relaxed);
+            if (tile >= tiles_) {
+                return;
+            }
+            auto first = tile * options_.tile_cells;
+            auto count = std::min(options_.tile_cells, cells_ - first);
+
+            if (!options_.use_pwrite) {
+                FillSpiral(options_.rows, options_.cols, first, count,
+                           map_ + first);
+                continue;
+            }
+
+            FillSpiral(options_.rows, options_.cols, first, count,
+                       buffer.data());
+            if (!PWriteAll(fd_, reinterpret_cast<const char*>(buffer.data()),
+                           count * sizeof(int32_t),
+                           static_cast<off_t>(first * sizeof(int32_t)))) {
+                int expected = 0;
+                error_.compare_exchange_strong(expected, errno);
+            }
+        }
+    }
+
+    const Options& options_;
+    const int fd_;
+    int32_t* const map_;
+    const uint64_t cells_;
+    const uint64_t tiles_;
+
+    std::atomic<uint64_t> next_tile_ = 0;
+    std::atomic<int> error_ = 0;
+};
+
+int Fail(const char* what, const char* path) {
+    std::cerr << what << ' ' << path << ": " << std::strerror(errno)
+              << std::endl;
+    return 1;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <out.bin> <rows> <cols> [--threads=N]"
+                     " [--tile-cells=N] [--pwrite]"
+                  << std::endl;
+        return 1;
+    }
+
+    // Values are stored as int32
+    if (options.rows > std::numeric_limits<int32_t>::max() / options.cols) {
+        std::cerr << "Matrix is too large" << std::endl;
+        return 1;
+    }
+    const size_t bytes = options.rows * options.cols * sizeof(int32_t);
+
+    int fd = open(options.path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return Fail("Failed to open", options.path);
+    }
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == -1) {
+        close(fd);
+        return Fail("Failed to truncate", options.path);
+    }
+
+    int32_t* map = nullptr;
+    if (!options.use_pwrite) {
+        void* ptr =
+            mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ptr == MAP_FAILED) {
+            close(fd);
+            return Fail("Failed to map", options.path);
+        }
+        map = static_cast<int32_t*>(ptr);
+    }
+
+    if (int error = Generator{options, fd, map}.Run(); error != 0) {
+        errno = error;
+        close(fd);
+        return Fail("Failed to write", options.path);
+    }
+
+    if (map != nullptr) {
+        if (msync(map, bytes, MS_SYNC) == -1) {
+            close(fd);
+            return Fail("Failed to sync", options.path);
+        }
+        munmap(map, bytes);
+    }
+    if (close(fd) == -1) {
+        return Fail("Failed to close", options.path);
+    }
+}
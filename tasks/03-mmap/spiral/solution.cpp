@@ -1,3 +1,5 @@
+#include "spiral.hpp"
+
 #include <cerrno>
 #include <cinttypes>
 #include <cstdint>
@@ -42,41 +44,12 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    int32_t* it = static_cast<int32_t*>(map);
-    auto idx = [cols](size_t r, size_t c) -> size_t { return r * cols + c; };
-
-    size_t top = 0, left = 0;
-    size_t bottom = rows - 1;
-    size_t right = cols - 1;
-
-    int32_t val = 1;
-    while (true) {
-        for (size_t c = left; c <= right; ++c) {
-            it[idx(top, c)] = val++;
-        }
-        if (++top > bottom) {
-            break;
-        }
-
-        for (size_t r = top; r <= bottom; ++r) {
-            it[idx(r, right)] = val++;
-        }
-        if (right-- == 0 || left > right) {
-            break;
-        }
-        for (size_t c = right + 1; c-- > left;) {
-            it[idx(bottom, c)] = val++;
-        }
-        if (bottom-- == 0 || top > bottom) {
-            break;
-        }
-
-        for (size_t r = bottom + 1; r-- > top;) {
-            it[idx(r, left)] = val++;
-        }
-        if (++left > right) {
-            break;
-        }
+    // Cells are filled in row-major order, so pages of the mapping are touched
+    // front to back once
+    madvise(map, bytes, MADV_SEQUENTIAL);
+    auto* out = static_cast<int32_t*>(map);
+    for (uint64_t r = 0; r < rows; ++r, out += cols) {
+        FillSpiralRow(rows, cols, r, 0, cols, out);
     }
 
     if (msync(map, bytes, MS_SYNC) == -1) {
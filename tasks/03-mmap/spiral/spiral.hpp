@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// The spiral is a sequence of rings: ring k consists of the cells with
+// min(r, c, rows - 1 - r, cols - 1 - c) == k and is walked clockwise starting
+// at (k, k). Everything below is computed in closed form, so the matrix can be
+// filled in any order, in particular row by row.
+
+// Number of cells in the rings before ring k
+inline uint64_t SpiralRingStart(uint64_t rows, uint64_t cols, uint64_t k) {
+    return rows * cols - (rows - 2 * k) * (cols - 2 * k);
+}
+
+// Value (1-based position along the spiral) of the cell (r, c)
+inline uint64_t SpiralIndex(uint64_t rows, uint64_t cols, uint64_t r,
+                            uint64_t c) {
+    const uint64_t k = std::min({r, c, rows - 1 - r, cols - 1 - c});
+    const uint64_t h = rows - 2 * k;
+    const uint64_t w = cols - 2 * k;
+    const uint64_t rr = r - k;
+    const uint64_t cc = c - k;
+
+    uint64_t pos;
+    if (rr == 0) {
+        pos = cc;
+    } else if (cc == w - 1) {
+        pos = (w - 1) + rr;
+    } else if (rr == h - 1) {
+        pos = (w - 1) + (h - 1) + (w - 1 - cc);
+    } else {
+        pos = 2 * (w - 1) + (h - 1) + (h - 1 - rr);
+    }
+    return SpiralRingStart(rows, cols, k) + pos + 1;
+}
+
+// Fills out[0, end - begin) with the values of the cells [begin, end) of row
+// r. Cells on the left and right sides of the outer rings are computed one by
+// one, the rest of the row is an edge of a single ring, i.e. an arithmetic
+// progression.
+inline void FillSpiralRow(uint64_t rows, uint64_t cols, uint64_t r,
+                          uint64_t begin, uint64_t end, int32_t* out) {
+    const uint64_t d = std::min(r, rows - 1 - r);
+    const uint64_t mid_begin = std::clamp(d, begin, end);
+    // Narrow matrices may have no such part
+    const uint64_t mid_end =
+        std::clamp(cols > d ? cols - d : 0, mid_begin, end);
+
+    for (uint64_t c = begin; c < mid_begin; ++c) {
+        *out++ = static_cast<int32_t>(SpiralIndex(rows, cols, r, c));
+    }
+
+    if (mid_begin < mid_end) {
+        // Top edge goes left to right, bottom edge right to left. Single row
+        // ring is a top edge.
+        auto value =
+            static_cast<int32_t>(SpiralIndex(rows, cols, r, mid_begin));
+        if (r == d) {
+            for (uint64_t c = mid_begin; c < mid_end; ++c) {
+                *out++ = value++;
+            }
+        } else {
+            for (uint64_t c = mid_begin; c < mid_end; ++c) {
+                *out++ = value--;
+            }
+        }
+    }
+
+    for (uint64_t c = mid_end; c < end; ++c) {
+        *out++ = static_cast<int32_t>(SpiralIndex(rows, cols, r, c));
+    }
+}
+
+// Fills out[0, count) with the values of cells [first, first + count) of the
+// row-major matrix. Cells may span several rows.
+inline void FillSpiral(uint64_t rows, uint64_t cols, uint64_t first,
+                       uint64_t count, int32_t* out) {
+    uint64_t r = first / cols;
+    uint64_t c = first % cols;
+    while (count > 0) {
+        const uint64_t n = std::min(count, cols - c);
+        FillSpiralRow(rows, cols, r, c, c + n, out);
+        out += n;
+        count -= n;
+        ++r;
+        c = 0;
+    }
+}
@@ -0,0 +1,88 @@
+#include "spiral.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Walks the spiral, the way the matrix is defined
+std::vector<int32_t> WalkSpiral(int64_t rows, int64_t cols) {
+    std::vector<int32_t> matrix(rows * cols);
+    int64_t top = 0, left = 0, bottom = rows - 1, right = cols - 1;
+    int32_t value = 1;
+    while (top <= bottom && left <= right) {
+        for (auto c = left; c <= right; ++c) {
+            matrix[top * cols + c] = value++;
+        }
+        ++top;
+        for (auto r = top; r <= bottom; ++r) {
+            matrix[r * cols + right] = value++;
+        }
+        --right;
+        if (top <= bottom) {
+            for (auto c = right; c >= left; --c) {
+                matrix[bottom * cols + c] = value++;
+            }
+            --bottom;
+        }
+        if (left <= right) {
+            for (auto r = bottom; r >= top; --r) {
+                matrix[r * cols + left] = value++;
+            }
+            ++left;
+        }
+    }
+    return matrix;
+}
+
+TEST_CASE("Example") {
+    std::vector<int32_t> expected = {
+        1,  2,  3,  4,  5,   //
+        14, 15, 16, 17, 6,   //
+        13, 20, 19, 18, 7,   //
+        12, 11, 10, 9,  8,   //
+    };
+    CHECK(WalkSpiral(4, 5) == expected);
+
+    std::vector<int32_t> matrix(20);
+    FillSpiral(4, 5, 0, 20, matrix.data());
+    CHECK(matrix == expected);
+}
+
+TEST_CASE("SpiralIndex") {
+    for (uint64_t rows = 1; rows <= 12; ++rows) {
+        for (uint64_t cols = 1; cols <= 12; ++cols) {
+            INFO("rows = " << rows << ", cols = " << cols);
+            auto expected = WalkSpiral(rows, cols);
+            for (uint64_t r = 0; r < rows; ++r) {
+                for (uint64_t c = 0; c < cols; ++c) {
+                    REQUIRE(SpiralIndex(rows, cols, r, c) ==
+                            static_cast<uint64_t>(expected[r * cols + c]));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("FillSpiral") {
+    for (auto [rows, cols] : {std::pair<uint64_t, uint64_t>{1, 1},
+                              {1, 9},
+                              {9, 1},
+                              {2, 120},
+                              {100, 3},
+                              {99, 103}}) {
+        INFO("rows = " << rows << ", cols = " << cols);
+        auto expected = WalkSpiral(rows, cols);
+        const uint64_t cells = rows * cols;
+
+        // Tiles cross row boundaries at arbitrary points
+        for (uint64_t tile : {uint64_t{1}, uint64_t{7}, cols, cells}) {
+            std::vector<int32_t> matrix(cells);
+            for (uint64_t first = 0; first < cells; first += tile) {
+                auto count = std::min(tile, cells - first);
+                FillSpiral(rows, cols, first, count, matrix.data() + first);
+            }
+            REQUIRE(matrix == expected);
+        }
+    }
+}
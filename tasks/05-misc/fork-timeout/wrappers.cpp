@@ -4,7 +4,7 @@
 #include <sys/types.h>
 
 struct ForkGlitches final : ForkGuard {
-    ForkGlitches() : rng_(42) {
+    ForkGlitches() : ForkGuard(GlitchScope::Process), rng_(42) {
     }
 
     pid_t Fork() override {
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// The automaton from count-substrings.cpp, generated at compile time for any
+// fixed set of patterns. AhoCorasick<"os", "rop"> counts the same things as
+// CountSubstrings.
+//
+// Every state has a full row of 256 transitions, failure links are folded
+// into it, so a step is one table lookup. States where some patterns end
+// have a non-zero mask of them. In the root state bytes which can't start a
+// pattern are skipped 16 at a time.
+
+template <size_t N>
+struct Pattern {
+    char chars[N] = {};
+
+    constexpr Pattern(const char (&str)[N]) {
+        std::copy_n(str, N, chars);
+    }
+
+    constexpr std::string_view View() const {
+        return {chars, N - 1};
+    }
+};
+
+template <Pattern... Patterns>
+class AhoCorasick {
+  public:
+    static constexpr size_t kPatternCount = sizeof...(Patterns);
+
+    static_assert(kPatternCount > 0 && kPatternCount <= 64,
+                  "Matched patterns are kept in a 64-bit mask");
+    static_assert(((Patterns.View().size() > 0) && ...),
+                  "Empty patterns are not supported");
+
+    // Number of occurrences of every pattern, in the order of Patterns
+    using Counts = std::array<size_t, kPatternCount>;
+
+    // Adds the occurrences in text to counts, overlapping ones included
+    static void Count(std::string_view text, Counts& counts) {
+        const auto* p = reinterpret_cast<const unsigned char*>(text.data());
+        const auto* end = p + text.size();
+        StateId state = 0;
+        while (p < end) {
+            if (state == 0) {
+                p = SkipToCandidate(p, end);
+                if (p == end) {
+                    break;
+                }
+            }
+            state = kAutomaton.next[state][*p++];
+            if (kAutomaton.outputs[state] != 0) {
+                AddOutputs(kAutomaton.outputs[state], counts);
+            }
+        }
+    }
+
+    static Counts Count(std::string_view text) {
+        Counts counts{};
+        Count(text, counts);
+        return counts;
+    }
+
+    // Number of states in the generated automaton
+    static constexpr size_t StateCount() {
+        return kAutomaton.states;
+    }
+
+  private:
+    static constexpr size_t kMaxStates = 1 + (Patterns.View().size() + ...);
+
+    using StateId = std::conditional_t<kMaxStates <= 256, uint8_t, uint16_t>;
+    static_assert(kMaxStates <= 65536);
+
+    struct Automaton {
+        size_t states = 1;
+        std::array<std::array<StateId, 256>, kMaxStates> next = {};
+        std::array<uint64_t, kMaxStates> outputs = {};
+        // Bytes which start some pattern
+        std::array<bool, 256> first = {};
+        // Nibble masks of the same set, see SkipToCandidate
+        std::array<uint8_t, 16> low_nibbles = {};
+        std::array<uint8_t, 16> high_nibbles = {};
+    };
+
+    static constexpr Automaton Build() {
+        constexpr std::array<std::string_view, kPatternCount> patterns = {
+            Patterns.View()...};
+        constexpr int kNone = -1;
+
+        Automaton automaton;
+        // Goto function of the trie
+        std::array<std::array<int, 256>, kMaxStates> trie = {};
+        for (auto& row : trie) {
+            row.fill(kNone);
+        }
+        for (size_t i = 0; i < kPatternCount; ++i) {
+            size_t state = 0;
+            for (char ch : patterns[i]) {
+                auto byte = static_cast<unsigned char>(ch);
+                if (trie[state][byte] == kNone) {
+                    trie[state][byte] = automaton.states++;
+                }
+                state = trie[state][byte];
+            }
+            automaton.outputs[state] |= uint64_t{1} << i;
+
+            auto byte = static_cast<unsigned char>(patterns[i][0]);
+            automaton.first[byte] = true;
+            // High nibbles are spread over 8 buckets, a byte is a candidate
+            // if both of its nibbles are in the same bucket
+            const uint8_t bucket = 1 << ((byte >> 4) % 8);
+            automaton.low_nibbles[byte & 0xF] |= bucket;
+            automaton.high_nibbles[byte >> 4] |= bucket;
+        }
+
+        // Breadth-first, so the failure link of a state is always complete
+        // before the state itself
+        std::array<size_t, kMaxStates> fail = {};
+        std::array<size_t, kMaxStates> queue = {};
+        size_t head = 0;
+        size_t tail = 0;
+        for (size_t byte = 0; byte < 256; ++byte) {
+            if (trie[0][byte] == kNone) {
+                automaton.next[0][byte] = 0;
+            } else {
+                automaton.next[0][byte] = trie[0][byte];
+                queue[tail++] = trie[0][byte];
+            }
+        }
+        while (head < tail) {
+            const size_t state = queue[head++];
+            automaton.outputs[state] |= automaton.outputs[fail[state]];
+            for (size_t byte = 0; byte < 256; ++byte) {
+                const auto fallback = automaton.next[fail[state]][byte];
+                if (trie[state][byte] == kNone) {
+                    automaton.next[state][byte] = fallback;
+                } else {
+                    const auto child = trie[state][byte];
+                    fail[child] = fallback;
+                    automaton.next[state][byte] = child;
+                    queue[tail++] = child;
+                }
+            }
+        }
+        return automaton;
+    }
+
+    static constexpr Automaton kAutomaton = Build();
+
+    static void AddOutputs(uint64_t mask, Counts& counts) {
+        for (; mask != 0; mask &= mask - 1) {
+            ++counts[__builtin_ctzll(mask)];
+        }
+    }
+
+#if defined(__x86_64__)
+    // Classifies 16 bytes at a time by their nibbles with two shuffles
+    // (SSSE3). Nibble matches are confirmed with the exact table.
+    __attribute__((target("ssse3"))) static const unsigned char*
+    SkipSsse3(const unsigned char* p, const unsigned char* end) {
+        const __m128i low_table = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(kAutomaton.low_nibbles.data()));
+        const __m128i high_table = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(kAutomaton.high_nibbles.data()));
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        while (end - p >= 16) {
+            const __m128i v =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const __m128i low =
+                _mm_shuffle_epi8(low_table, _mm_and_si128(v, nibble));
+            const __m128i high = _mm_shuffle_epi8(
+                high_table, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+            const __m128i miss = _mm_cmpeq_epi8(_mm_and_si128(low, high),
+                                                _mm_setzero_si128());
+            unsigned candidates = ~_mm_movemask_epi8(miss) & 0xFFFF;
+            for (; candidates != 0; candidates &= candidates - 1) {
+                const auto* candidate = p + __builtin_ctz(candidates);
+                if (kAutomaton.first[*candidate]) {
+                    return candidate;
+                }
+            }
+            p += 16;
+        }
+        return p;
+    }
+
+    static bool HasSsse3() {
+        static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+        return has_ssse3;
+    }
+#endif
+
+    // Returns the first byte which starts some pattern, or end
+    static const unsigned char* SkipToCandidate(const unsigned char* p,
+                                                const unsigned char* end) {
+        if (kAutomaton.first[*p]) {
+            return p;
+        }
+#if defined(__x86_64__)
+        if (HasSsse3()) {
+            p = SkipSsse3(p, end);
+        }
+#endif
+        while (p < end && !kAutomaton.first[*p]) {
+            ++p;
+        }
+        return p;
+    }
+};
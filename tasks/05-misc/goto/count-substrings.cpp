@@ -1,5 +1,18 @@
 #include "count-substrings.h"
 
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Longest pattern, "rop"
+constexpr size_t kMaxPatternLength = 3;
+// Smaller chunks aren't worth a thread
+constexpr size_t kMinChunkSize = 1 << 16;
+
+}  // namespace
+
 SubstringsCount CountSubstrings(const char* s) {
     SubstringsCount res{};
     if (s == nullptr) {
@@ -78,3 +91,142 @@ Sro:
 END:
     return res;
 }
+
+void CountSubstrings(std::span<const char> data, CountState& state) {
+    using Node = CountState::Node;
+
+    SubstringsCount& res = state.count;
+    const char* it = data.data();
+    const char* end = it + data.size();
+    char ch = '\0';
+
+    switch (state.node) {
+    case Node::So:
+        goto So;
+    case Node::Sr:
+        goto Sr;
+    case Node::Sro:
+        goto Sro;
+    default:
+        goto S0;
+    }
+
+S0:
+    if (it == end) {
+        state.node = Node::S0;
+        goto END;
+    }
+    ch = *it++;
+    if (ch == 'o') {
+        goto So;
+    }
+    if (ch == 'r') {
+        goto Sr;
+    }
+    goto S0;
+
+So:
+    if (it == end) {
+        state.node = Node::So;
+        goto END;
+    }
+    ch = *it++;
+    if (ch == 's') {
+        ++res.os_num;
+        goto S0;
+    }
+    if (ch == 'o') {
+        goto So;
+    }
+    if (ch == 'r') {
+        goto Sr;
+    }
+    goto S0;
+
+Sr:
+    if (it == end) {
+        state.node = Node::Sr;
+        goto END;
+    }
+    ch = *it++;
+    if (ch == 'o') {
+        goto Sro;
+    }
+    if (ch == 'r') {
+        goto Sr;
+    }
+    goto S0;
+
+Sro:
+    if (it == end) {
+        state.node = Node::Sro;
+        goto END;
+    }
+    ch = *it++;
+    if (ch == 'p') {
+        ++res.rop_num;
+        goto S0;
+    }
+    if (ch == 's') {
+        ++res.os_num;
+        goto S0;
+    }
+    if (ch == 'o') {
+        goto So;
+    }
+    if (ch == 'r') {
+        goto Sr;
+    }
+    goto S0;
+
+END:
+    return;
+}
+
+SubstringsCount CountSubstringsParallel(std::span<const char> data,
+                                        unsigned threads) {
+    const size_t chunks = std::clamp<size_t>(data.size() / kMinChunkSize, 1,
+                                             std::max(1u, threads));
+    std::vector<size_t> bounds;
+    for (size_t i = 0; i <= chunks; ++i) {
+        bounds.push_back(data.size() / chunks * i);
+    }
+    bounds.back() = data.size();
+
+    std::vector<CountState> states(chunks);
+    auto work = [&](size_t chunk) {
+        CountSubstrings(
+            data.subspan(bounds[chunk], bounds[chunk + 1] - bounds[chunk]),
+            states[chunk]);
+    };
+    std::vector<std::thread> workers;
+    for (size_t chunk = 1; chunk < chunks; ++chunk) {
+        workers.emplace_back(work, chunk);
+    }
+    work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // The node depends only on the last kMaxPatternLength - 1 bytes read, so
+    // a chunk resumed from the node the previous one ended in differs from
+    // the one started from S0 only in the matches ending in its head: those
+    // are the matches crossing the border.
+    constexpr size_t kReach = kMaxPatternLength - 1;
+    SubstringsCount total;
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        total += states[chunk].count;
+        if (chunk == 0) {
+            continue;
+        }
+        auto head = data.subspan(bounds[chunk], kReach);
+        CountState resumed{.node = states[chunk - 1].node, .count = {}};
+        CountState fresh;
+        CountSubstrings(head, resumed);
+        CountSubstrings(head, fresh);
+        total.os_num += resumed.count.os_num - fresh.count.os_num;
+        total.rop_num += resumed.count.rop_num - fresh.count.rop_num;
+    }
+    return total;
+}
+
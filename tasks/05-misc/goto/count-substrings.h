@@ -2,12 +2,44 @@
 
 #include <compare>  // IWYU pragma: export
 #include <cstddef>
+#include <span>
 
 struct SubstringsCount {
     size_t rop_num = 0;
     size_t os_num = 0;
 
     auto operator<=>(const SubstringsCount& other) const = default;
+
+    SubstringsCount& operator+=(const SubstringsCount& other) {
+        rop_num += other.rop_num;
+        os_num += other.os_num;
+        return *this;
+    }
+};
+
+// Automaton state after a chunk, counting can be resumed from it with the
+// next chunk of the same text
+struct CountState {
+    enum class Node {
+        S0,
+        So,
+        Sr,
+        Sro,
+    };
+
+    Node node = Node::S0;
+    SubstringsCount count;
 };
 
+// A single pass over the NUL-terminated string, no allocations
 SubstringsCount CountSubstrings(const char* s);
+
+// Counts the substrings in data, which doesn't need to be NUL-terminated,
+// continuing from state. Matches spanning the previous chunks are counted
+// as well.
+void CountSubstrings(std::span<const char> data, CountState& state);
+
+// Splits data between up to threads threads, at least 64 KiB each, and counts
+// the matches crossing the borders of their chunks separately
+SubstringsCount CountSubstringsParallel(std::span<const char> data,
+                                        unsigned threads);
@@ -0,0 +1,107 @@
+#include "aho-corasick.h"
+#include "count-substrings.h"
+
+#include <build.hpp>
+#include <pcg-random.hpp>
+
+#include <catch2/catch_get_random_seed.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+template <size_t N>
+std::array<size_t, N> NaiveCount(std::string_view text,
+                                 const std::array<std::string_view, N>& words) {
+    std::array<size_t, N> counts{};
+    for (size_t i = 0; i < N; ++i) {
+        for (auto pos = text.find(words[i]); pos != std::string_view::npos;
+             pos = text.find(words[i], pos + 1)) {
+            ++counts[i];
+        }
+    }
+    return counts;
+}
+
+// Text made of random bytes from alphabet and random pieces of words
+template <size_t N>
+std::string RandomText(PCGRandom& rng, size_t length,
+                       std::string_view alphabet,
+                       const std::array<std::string_view, N>& words) {
+    std::string text;
+    while (text.size() < length) {
+        if (rng() % 4 != 0) {
+            text += alphabet[rng() % alphabet.size()];
+        } else {
+            auto word = words[rng() % N];
+            text += word.substr(rng() % word.size());
+        }
+    }
+    return text;
+}
+
+TEST_CASE("SameAsGoto") {
+    using Matcher = AhoCorasick<"os", "rop">;
+    STATIC_REQUIRE(Matcher::StateCount() == 6);
+
+    PCGRandom rng{Catch::getSeed()};
+    constexpr std::array<std::string_view, 2> kWords = {"os", "rop"};
+    for (size_t length : {0, 1, 10, 100, 10000, 1000000}) {
+        auto text = RandomText(rng, length, "oprsx", kWords);
+        auto counts = Matcher::Count(text);
+        auto expected = CountSubstrings(text.c_str());
+        CHECK(counts[0] == expected.os_num);
+        CHECK(counts[1] == expected.rop_num);
+    }
+}
+
+TEST_CASE("Overlapping") {
+    using Matcher = AhoCorasick<"he", "she", "his", "hers", "e", "aaa">;
+    constexpr std::array<std::string_view, 6> kWords = {"he",   "she", "his",
+                                                        "hers", "e",   "aaa"};
+    for (std::string_view text : {"ushers", "hishers", "aaaaaa", "shhe"}) {
+        CHECK(Matcher::Count(text) == NaiveCount(text, kWords));
+    }
+
+    PCGRandom rng{Catch::getSeed()};
+    for (int i = 0; i < 100; ++i) {
+        auto text = RandomText(rng, rng() % 500, "aehirsu", kWords);
+        CHECK(Matcher::Count(text) == NaiveCount(text, kWords));
+    }
+}
+
+// Log tokens, enough of them for more than 256 states and a prefilter with
+// false positives of the nibble classification
+#define LOG_TOKENS                                                            \
+    "ERROR", "WARN", "INFO", "DEBUG", "TRACE", "FATAL", "timeout",            \
+        "connection refused", "connection reset", "GET /", "POST /",          \
+        "PUT /", "DELETE /", "HTTP/1.1\" 500", "HTTP/1.1\" 404",              \
+        "HTTP/1.1\" 200", "segfault", "oom-killer", "panic", "retry",         \
+        "retrying", "user=", "uid=0", "sshd[", "Failed password",             \
+        "Accepted publickey", "kernel:", "\xD0\x9E\xD1\x88\xD0\xB8\xD0\xB1",  \
+        "\t\t", "::1", "127.0.0.1", "0x", "NULL", "nil", "Exception",         \
+        "Traceback", "at java.", "Caused by:", "authentication failure",      \
+        "disk quota exceeded", "|", "~", "@"
+
+TEST_CASE("LogTokens") {
+    using Matcher = AhoCorasick<LOG_TOKENS>;
+    constexpr std::array<std::string_view, Matcher::kPatternCount> kWords = {
+        LOG_TOKENS};
+    STATIC_REQUIRE(Matcher::StateCount() > 256);
+
+    PCGRandom rng{Catch::getSeed()};
+    // Mostly bytes which can't start a token, so the prefilter skips a lot
+    constexpr std::string_view kAlphabet = "bcgjkmoqvxyz ,.;:\n\x80\xFF";
+    for (int i = 0; i < 100; ++i) {
+        auto text = RandomText(rng, rng() % 3000, kAlphabet, kWords);
+        CHECK(Matcher::Count(text) == NaiveCount(text, kWords));
+    }
+
+    if constexpr (kBuildType == BuildType::Release) {
+        auto text = RandomText(rng, 10'000'000, kAlphabet, kWords);
+        CHECK(Matcher::Count(text) == NaiveCount(text, kWords));
+    }
+}
+
+#undef LOG_TOKENS
@@ -6,8 +6,10 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include <string>
+#include <vector>
 
 std::ostream& operator<<(std::ostream& os, SubstringsCount cnt) {
     return os << "{rop = " << cnt.rop_num << ", os = " << cnt.os_num << "}";
@@ -85,3 +87,46 @@ TEST_CASE("StressTest") {
         }
     }
 }
+
+TEST_CASE("Chunks") {
+    PCGRandom rng{42};
+    rng.Warmup();
+
+    for (size_t i = 0; i < 20; ++i) {
+        std::string test = GenerateBiasedString(rng.Generate32() % 1000, rng);
+        const auto expected = DummyCountSubstrings(test);
+
+        // No terminating NUL is needed, every chunk is a separate buffer
+        CountState state;
+        size_t pos = 0;
+        while (pos < test.size()) {
+            size_t size = std::min<size_t>(rng.Generate32() % 5,
+                                           test.size() - pos);
+            std::vector<char> chunk(test.begin() + pos,
+                                    test.begin() + pos + size);
+            CountSubstrings(chunk, state);
+            pos += size;
+        }
+        CHECK(state.count == expected);
+    }
+}
+
+TEST_CASE("Parallel") {
+    PCGRandom rng{42};
+    rng.Warmup();
+
+    for (size_t len : {0, 3, 1000, 1'000'000}) {
+        std::string test = GenerateBiasedString(len, rng);
+        const auto expected = DummyCountSubstrings(test);
+        for (unsigned threads : {1, 2, 7}) {
+            CHECK(CountSubstringsParallel(test, threads) == expected);
+        }
+    }
+
+    // Borders right inside the patterns
+    std::string test(1 << 18, 'x');
+    test.replace((1 << 16) - 1, 3, "rop");
+    test.replace((2 << 16) - 2, 3, "rop");
+    test.replace((3 << 16) - 1, 2, "os");
+    CHECK(CountSubstringsParallel(test, 4) == DummyCountSubstrings(test));
+}
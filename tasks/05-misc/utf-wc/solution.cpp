@@ -1,65 +1,140 @@
+#include "utf8-stream.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
 #include <cstddef>
-#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
 #include <iostream>
-#include <iterator>
-#include <string>
+#include <optional>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
-using ch_type = unsigned char;
+// Usage: solution [--validate] [--threads=N] [FILE]
+//
+// Regular files (FILE or a redirected stdin) are mapped and counted by
+// several threads, anything else is read by fixed-size windows.
 
-bool is_cyrillic(char32_t cp) {
-    return ((cp >= 0x0400 && cp <= 0x052F) || (cp >= 0x1C80 && cp <= 0x1C88) ||
-            cp == 0x1D2B || (cp >= 0xA640 && cp <= 0xA66D) ||
-            (cp >= 0xA680 && cp <= 0xA69B));
-}
+constexpr size_t kWindowSize = 1 << 20;
 
-ch_type read_byte(const std::string& buf, std::size_t& pos) {
-    return static_cast<ch_type>(buf[pos++]);
-}
+struct Result {
+    Utf8Counts counts;
+    std::optional<uint64_t> invalid;
+};
 
-char32_t next_cp(const std::string& buf, std::size_t& pos) {
-    ch_type b0 = read_byte(buf, pos);
-    if ((b0 & 0x80u) == 0) {
-        return b0;
+std::optional<Result> CountStream(int fd, bool validate) {
+    std::vector<char> window(kWindowSize);
+    Utf8Counter counter{validate};
+    while (true) {
+        ssize_t ret = read(fd, window.data(), window.size());
+        if (ret == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ret == -1) {
+            return std::nullopt;
+        }
+        if (ret == 0) {
+            break;
+        }
+        counter.Feed(window.data(), ret);
     }
+    auto counts = counter.Finish();
+    return Result{counts, counter.InvalidOffset()};
+}
 
-    if ((b0 & 0xE0u) == 0xC0u) {
-        ch_type b1 = read_byte(buf, pos);
-        return ((b0 & 0x1Fu) << 6) | (b1 & 0x3Fu);
+Result CountMapped(const char* data, size_t size, unsigned threads,
+                   bool validate) {
+    size_t invalid = size;
+    Result result{
+        .counts = CountUtf8Parallel(data, size, threads,
+                                    validate ? &invalid : nullptr),
+        .invalid = std::nullopt,
+    };
+    if (invalid != size) {
+        result.invalid = invalid;
     }
+    return result;
+}
 
-    if ((b0 & 0xF0u) == 0xE0u) {
-        ch_type b1 = read_byte(buf, pos);
-        ch_type b2 = read_byte(buf, pos);
-        char32_t cp = (b0 & 0x0Fu);
-        cp = (cp << 6) | (b1 & 0x3Fu);
-        cp = (cp << 6) | (b2 & 0x3Fu);
-        return cp;
+int main(int argc, char** argv) {
+    bool validate = false;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* path = nullptr;
+    bool ok = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--validate") {
+            validate = true;
+        } else if (arg.starts_with("--threads=")) {
+            auto value = arg.substr(10);
+            auto [ptr, ec] = std::from_chars(
+                value.data(), value.data() + value.size(), threads);
+            ok = ok && ec == std::errc{} &&
+                 ptr == value.data() + value.size() && threads > 0;
+        } else if (!path && !arg.starts_with("--")) {
+            path = argv[i];
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--validate] [--threads=N] [FILE]\n";
+        return 1;
     }
 
-    ch_type b1 = read_byte(buf, pos);
-    ch_type b2 = read_byte(buf, pos);
-    ch_type b3 = read_byte(buf, pos);
-    char32_t cp = (b0 & 0x07u);
-    cp = (cp << 6) | (b1 & 0x3Fu);
-    cp = (cp << 6) | (b2 & 0x3Fu);
-    cp = (cp << 6) | (b3 & 0x3Fu);
-    return cp;
-}
-
-int main() {
-    std::string input((std::istreambuf_iterator<char>(std::cin)),
-                      std::istreambuf_iterator<char>());
+    int fd = STDIN_FILENO;
+    if (path) {
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            std::cerr << "open: " << std::strerror(errno) << "\n";
+            return 1;
+        }
+    }
 
-    std::size_t total = 0, cyr = 0;
+    struct stat st{};
 
-    for (std::size_t i = 0; i < input.size();) {
-        char32_t cp = next_cp(input, i);
-        total++;
-        if (is_cyrillic(cp)) {
-            cyr++;
+    // Counting starts at the current position, as if the file was read: the
+    // beginning of a redirected stdin may be consumed already. The mapping
+    // has to start on a page boundary, the bytes before the position are
+    // skipped.
+    std::optional<Result> result;
+    const off_t pos = lseek(fd, 0, SEEK_CUR);
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && pos >= 0 &&
+        pos < st.st_size) {
+        const auto page = static_cast<off_t>(sysconf(_SC_PAGESIZE));
+        const off_t offset = pos / page * page;
+        const auto skip = static_cast<size_t>(pos - offset);
+        const auto size = static_cast<size_t>(st.st_size - offset);
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, offset);
+        if (data != MAP_FAILED) {
+            madvise(data, size, MADV_SEQUENTIAL);
+            result = CountMapped(static_cast<const char*>(data) + skip,
+                                 size - skip, threads, validate);
+            munmap(data, size);
+            // Leaves the position where reading would
+            lseek(fd, st.st_size, SEEK_SET);
         }
     }
+    if (!result) {
+        // Pipes, terminals and files which can't be mapped
+        result = CountStream(fd, validate);
+    }
+    if (!result) {
+        std::cerr << "read: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    if (result->invalid) {
+        std::cerr << "Malformed UTF-8 at byte " << *result->invalid << '\n';
+        return 1;
+    }
 
-    std::cout << total << ' ' << cyr << '\n';
+    std::cout << result->counts.chars << ' ' << result->counts.cyrillic
+              << '\n';
     return 0;
 }
@@ -0,0 +1,234 @@
+#include "utf8-count.hpp"
+#include "utf8-stream.hpp"
+
+#include <pcg-random.hpp>
+
+#include <catch2/catch_get_random_seed.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+bool IsCyrillic(char32_t cp) {
+    return (cp >= 0x0400 && cp <= 0x052F) || (cp >= 0x1C80 && cp <= 0x1C88) ||
+           cp == 0x1D2B || (cp >= 0xA640 && cp <= 0xA66D) ||
+           (cp >= 0xA680 && cp <= 0xA69B);
+}
+
+void Encode(char32_t cp, std::string& out) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Mostly code points around the borders of the Cyrillic ranges
+char32_t RandomCodePoint(PCGRandom& rng) {
+    static const std::vector<std::pair<char32_t, char32_t>> kRanges = {
+        {0x0000, 0x007F}, {0x0080, 0x07FF}, {0x03F0, 0x0540},
+        {0x1C70, 0x1C90}, {0x1D20, 0x1D30}, {0xA630, 0xA6A0},
+        {0x0800, 0xD7FF}, {0xE000, 0xFFFF}, {0x10000, 0x10FFFF},
+    };
+    const auto& [lo, hi] = kRanges[rng() % kRanges.size()];
+    return lo + rng() % (hi - lo + 1);
+}
+
+std::vector<Utf8Impl> Impls() {
+    std::vector<Utf8Impl> impls = {Utf8Impl::Scalar, Utf8Impl::Best};
+#if defined(__x86_64__)
+    impls.push_back(Utf8Impl::Sse2);
+    if (__builtin_cpu_supports("avx2")) {
+        impls.push_back(Utf8Impl::Avx2);
+    }
+#endif
+    return impls;
+}
+
+Utf8Counts Count(const std::string& text, size_t begin, size_t end,
+                 Utf8Impl impl) {
+    Utf8Counts counts;
+    CountUtf8(text.data() + begin, end - begin, counts, impl);
+    return counts;
+}
+
+TEST_CASE("Count") {
+    PCGRandom rng{Catch::getSeed()};
+    for (int iter = 0; iter < 200; ++iter) {
+        // Long ASCII runs exercise the fast path, long texts the flushes of
+        // the byte counters
+        const size_t length = iter % 10 == 0 ? 20000 : rng() % 300;
+        const bool ascii = iter % 3 == 0;
+
+        std::string text;
+        std::vector<size_t> starts;
+        Utf8Counts expected;
+        for (size_t i = 0; i < length; ++i) {
+            char32_t cp = ascii && rng() % 8 != 0 ? rng() % 0x80
+                                                  : RandomCodePoint(rng);
+            starts.push_back(text.size());
+            Encode(cp, text);
+            ++expected.chars;
+            expected.cyrillic += IsCyrillic(cp);
+        }
+        starts.push_back(text.size());
+
+        for (auto impl : Impls()) {
+            INFO("impl = " << static_cast<int>(impl));
+            CHECK(Count(text, 0, text.size(), impl) == expected);
+            if (length > 300) {
+                continue;
+            }
+            // Any code point aligned window
+            size_t first = rng() % starts.size();
+            size_t last = first + rng() % (starts.size() - first);
+            auto window = Count(text, starts[first], starts[last], impl);
+            CHECK(window == Count(text, starts[first], starts[last],
+                                  Utf8Impl::Scalar));
+            CHECK(window.chars == last - first);
+        }
+    }
+}
+
+TEST_CASE("Truncated") {
+    // Cut sequences are characters, but not Cyrillic ones
+    for (std::string text : {"\xD4", "\xE1\xB2", "\xEA\x99", "\xD0"}) {
+        for (auto impl : Impls()) {
+            Utf8Counts counts;
+            CountUtf8(text.data(), text.size(), counts, impl);
+            CHECK(counts.chars == 1);
+            CHECK(counts.cyrillic == (text == "\xD0"));
+        }
+    }
+}
+
+TEST_CASE("Validate") {
+    PCGRandom rng{Catch::getSeed()};
+    std::string valid;
+    for (int i = 0; i < 1000; ++i) {
+        Encode(RandomCodePoint(rng), valid);
+    }
+    CHECK(FindInvalidUtf8(valid.data(), valid.size()) == valid.size());
+    CHECK(FindInvalidUtf8("", 0) == 0);
+
+    const std::string prefix(37, 'a');
+    for (std::string bad : {
+             "\x80",              // Lone continuation
+             "\xC0\xAF",          // Overlong
+             "\xC1\xBF",          // Overlong
+             "\xE0\x9F\xBF",      // Overlong
+             "\xED\xA0\x80",      // Surrogate
+             "\xF0\x8F\xBF\xBF",  // Overlong
+             "\xF4\x90\x80\x80",  // Above U+10FFFF
+             "\xF5\x80\x80\x80",  // Invalid lead
+             "\xFF",              // Invalid lead
+             "\xD0",              // Truncated
+             "\xE2\x82",          // Truncated
+             "\xD0\x41",          // Missing continuation
+             "\xE2\x82\x41",      // Missing continuation
+         }) {
+        INFO("bad = " << bad);
+        auto text = prefix + bad + prefix;
+        if (bad == "\xD0" || bad == "\xE2\x82") {
+            text = prefix + bad;
+        }
+        CHECK(FindInvalidUtf8(text.data(), text.size()) == prefix.size());
+    }
+}
+
+std::string RandomText(PCGRandom& rng, size_t length) {
+    std::string text;
+    for (size_t i = 0; i < length; ++i) {
+        Encode(RandomCodePoint(rng), text);
+    }
+    return text;
+}
+
+TEST_CASE("CompletePrefix") {
+    CHECK(CompleteUtf8Prefix("", 0) == 0);
+    CHECK(CompleteUtf8Prefix("ab", 2) == 2);
+    CHECK(CompleteUtf8Prefix("a\xD0", 2) == 1);
+    CHECK(CompleteUtf8Prefix("a\xD0\x90", 3) == 3);
+    CHECK(CompleteUtf8Prefix("a\xF0\x9F\x98", 4) == 1);
+    CHECK(CompleteUtf8Prefix("a\xF0\x9F\x98\x80", 5) == 5);
+    // Stray continuations are left as they are
+    CHECK(CompleteUtf8Prefix("a\x80\x80\x80\x80", 5) == 5);
+}
+
+TEST_CASE("Stream") {
+    PCGRandom rng{Catch::getSeed()};
+    for (int iter = 0; iter < 50; ++iter) {
+        const auto text = RandomText(rng, rng() % 2000);
+        Utf8Counts expected;
+        CountUtf8(text.data(), text.size(), expected);
+
+        Utf8Counter counter{true};
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t piece = std::min<size_t>(rng() % 8, text.size() - pos);
+            counter.Feed(text.data() + pos, piece);
+            pos += piece;
+        }
+        CHECK(counter.Finish() == expected);
+        CHECK_FALSE(counter.InvalidOffset().has_value());
+    }
+
+    // Malformed sequences are found across pieces as well
+    const std::string text = "ab\xE2\x82" "cd";
+    Utf8Counter counter{true};
+    for (char c : text) {
+        counter.Feed(&c, 1);
+    }
+    counter.Finish();
+    CHECK(counter.InvalidOffset() == 2);
+
+    Utf8Counter truncated{true};
+    truncated.Feed("ab\xE2\x82", 4);
+    CHECK(truncated.Finish().chars == 3);
+    CHECK(truncated.InvalidOffset() == 2);
+}
+
+TEST_CASE("Parallel") {
+    PCGRandom rng{Catch::getSeed()};
+    // Big enough to be split between threads
+    const auto text = RandomText(rng, 3 * kMinBytesPerThread / 2);
+    Utf8Counts expected;
+    CountUtf8(text.data(), text.size(), expected);
+
+    for (size_t parts : {1, 2, 7}) {
+        auto bounds = SplitUtf8(text.data(), text.size(), parts);
+        CHECK(bounds.front() == 0);
+        CHECK(bounds.back() == text.size());
+        for (auto bound : bounds) {
+            CHECK((bound == text.size() || (text[bound] & 0xC0) != 0x80));
+        }
+    }
+
+    for (unsigned threads : {1, 3, 8}) {
+        size_t invalid = 0;
+        CHECK(CountUtf8Parallel(text.data(), text.size(), threads, &invalid) ==
+              expected);
+        CHECK(invalid == text.size());
+    }
+
+    auto broken = text;
+    const size_t bad = broken.size() - 100;
+    broken[bad] = static_cast<char>(0xFF);
+    size_t invalid = 0;
+    CountUtf8Parallel(broken.data(), broken.size(), 4, &invalid);
+    CHECK(invalid == bad);
+
+    CHECK(CountUtf8Parallel("", 0, 4, &invalid) == Utf8Counts{});
+    CHECK(invalid == 0);
+}
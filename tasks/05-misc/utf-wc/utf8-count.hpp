@@ -0,0 +1,323 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Counting doesn't decode anything: every code point has exactly one byte
+// outside of 0x80..0xBF, and all the Cyrillic ranges can be recognized by the
+// lead byte, sometimes together with one or two bytes after it:
+//
+//   U+0400..U+04FF  D0..D3 xx
+//   U+0500..U+052F  D4 80..AF
+//   U+1C80..U+1C88  E1 B2 80..88
+//   U+1D2B          E1 B4 AB
+//   U+A640..U+A66D  EA 99 80..AD
+//   U+A680..U+A69B  EA 9A 80..9B
+
+struct Utf8Counts {
+    uint64_t chars = 0;
+    uint64_t cyrillic = 0;
+
+    Utf8Counts& operator+=(const Utf8Counts& other) {
+        chars += other.chars;
+        cyrillic += other.cyrillic;
+        return *this;
+    }
+
+    bool operator==(const Utf8Counts&) const = default;
+};
+
+namespace utf8_detail {
+
+enum ByteClass : uint8_t {
+    kContinuation,
+    kOther,
+    // U+0400..U+04FF, no need to look further
+    kCyrillic,
+    // D4, E1 and EA, the next bytes decide
+    kMaybeCyrillic,
+};
+
+constexpr std::array<uint8_t, 256> kByteClasses = [] {
+    std::array<uint8_t, 256> classes{};
+    for (int b = 0; b < 256; ++b) {
+        if (b >= 0x80 && b <= 0xBF) {
+            classes[b] = kContinuation;
+        } else if (b >= 0xD0 && b <= 0xD3) {
+            classes[b] = kCyrillic;
+        } else if (b == 0xD4 || b == 0xE1 || b == 0xEA) {
+            classes[b] = kMaybeCyrillic;
+        } else {
+            classes[b] = kOther;
+        }
+    }
+    return classes;
+}();
+
+// Checks a sequence starting with D4, E1 or EA. Bytes past the end of the
+// buffer are treated as missing, so a truncated sequence is never Cyrillic.
+inline bool IsCyrillicTail(const unsigned char* p, size_t available) {
+    if (p[0] == 0xD4) {
+        return available >= 2 && p[1] >= 0x80 && p[1] <= 0xAF;
+    }
+    if (available < 3) {
+        return false;
+    }
+    if (p[0] == 0xE1) {
+        return (p[1] == 0xB2 && p[2] >= 0x80 && p[2] <= 0x88) ||
+               (p[1] == 0xB4 && p[2] == 0xAB);
+    }
+    return (p[1] == 0x99 && p[2] >= 0x80 && p[2] <= 0xAD) ||
+           (p[1] == 0x9A && p[2] >= 0x80 && p[2] <= 0x9B);
+}
+
+// Scalar version, also used for the tails of the vectorized ones
+inline void CountScalar(const unsigned char* p, const unsigned char* end,
+                        Utf8Counts& counts) {
+    for (; p < end; ++p) {
+        const auto cls = kByteClasses[*p];
+        counts.chars += cls != kContinuation;
+        counts.cyrillic += cls == kCyrillic;
+        if (cls == kMaybeCyrillic) {
+            counts.cyrillic += IsCyrillicTail(p, end - p);
+        }
+    }
+}
+
+#if defined(__x86_64__)
+
+// Per-byte counters overflow after 255 blocks
+constexpr size_t kMaxBlocksPerFlush = 255;
+
+inline uint64_t SumBytes(__m128i v) {
+    const __m128i sums = _mm_sad_epu8(v, _mm_setzero_si128());
+    return _mm_cvtsi128_si64(sums) +
+           _mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums));
+}
+
+// SSE2 is always available on x86-64. A block needs one byte after it, the
+// D4 check looks at the next byte with an unaligned load.
+inline const unsigned char* CountSse2(const unsigned char* p,
+                                      const unsigned char* end,
+                                      Utf8Counts& counts) {
+    constexpr size_t kBlock = 16;
+    const __m128i last_continuation = _mm_set1_epi8(static_cast<char>(0xBF));
+    const __m128i cyrillic_mask = _mm_set1_epi8(static_cast<char>(0xFC));
+    const __m128i cyrillic_lead = _mm_set1_epi8(static_cast<char>(0xD0));
+    const __m128i d4 = _mm_set1_epi8(static_cast<char>(0xD4));
+    const __m128i after_d4_end = _mm_set1_epi8(static_cast<char>(0xB0));
+    const __m128i e1 = _mm_set1_epi8(static_cast<char>(0xE1));
+    const __m128i ea = _mm_set1_epi8(static_cast<char>(0xEA));
+
+    while (static_cast<size_t>(end - p) > kBlock) {
+        __m128i chars = _mm_setzero_si128();
+        __m128i cyrillic = _mm_setzero_si128();
+        for (size_t blocks = 0;
+             blocks < kMaxBlocksPerFlush &&
+             static_cast<size_t>(end - p) > kBlock;
+             ++blocks, p += kBlock) {
+            const __m128i v =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            if (_mm_movemask_epi8(v) == 0) {
+                counts.chars += kBlock;
+                continue;
+            }
+            const __m128i next =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+
+            // Signed comparisons: 0x80..0xBF are the smallest values
+            const __m128i lead = _mm_cmpgt_epi8(v, last_continuation);
+            const __m128i cyr = _mm_or_si128(
+                _mm_cmpeq_epi8(_mm_and_si128(v, cyrillic_mask), cyrillic_lead),
+                _mm_and_si128(_mm_cmpeq_epi8(v, d4),
+                              _mm_cmplt_epi8(next, after_d4_end)));
+            chars = _mm_sub_epi8(chars, lead);
+            cyrillic = _mm_sub_epi8(cyrillic, cyr);
+
+            unsigned rare = _mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(v, e1), _mm_cmpeq_epi8(v, ea)));
+            for (; rare != 0; rare &= rare - 1) {
+                const auto* q = p + __builtin_ctz(rare);
+                counts.cyrillic += IsCyrillicTail(q, end - q);
+            }
+        }
+        counts.chars += SumBytes(chars);
+        counts.cyrillic += SumBytes(cyrillic);
+    }
+    return p;
+}
+
+__attribute__((target("avx2"))) inline uint64_t SumBytesAvx2(__m256i v) {
+    return SumBytes(_mm256_castsi256_si128(v)) +
+           SumBytes(_mm256_extracti128_si256(v, 1));
+}
+
+// Same as CountSse2, 32 bytes at a time
+__attribute__((target("avx2"))) inline const unsigned char* CountAvx2(
+    const unsigned char* p, const unsigned char* end, Utf8Counts& counts) {
+    constexpr size_t kBlock = 32;
+    const __m256i last_continuation =
+        _mm256_set1_epi8(static_cast<char>(0xBF));
+    const __m256i cyrillic_mask = _mm256_set1_epi8(static_cast<char>(0xFC));
+    const __m256i cyrillic_lead = _mm256_set1_epi8(static_cast<char>(0xD0));
+    const __m256i d4 = _mm256_set1_epi8(static_cast<char>(0xD4));
+    const __m256i after_d4_end = _mm256_set1_epi8(static_cast<char>(0xB0));
+    const __m256i e1 = _mm256_set1_epi8(static_cast<char>(0xE1));
+    const __m256i ea = _mm256_set1_epi8(static_cast<char>(0xEA));
+
+    while (static_cast<size_t>(end - p) > kBlock) {
+        __m256i chars = _mm256_setzero_si256();
+        __m256i cyrillic = _mm256_setzero_si256();
+        for (size_t blocks = 0;
+             blocks < kMaxBlocksPerFlush &&
+             static_cast<size_t>(end - p) > kBlock;
+             ++blocks, p += kBlock) {
+            const __m256i v =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            if (_mm256_movemask_epi8(v) == 0) {
+                counts.chars += kBlock;
+                continue;
+            }
+            const __m256i next =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+
+            const __m256i lead = _mm256_cmpgt_epi8(v, last_continuation);
+            const __m256i cyr = _mm256_or_si256(
+                _mm256_cmpeq_epi8(_mm256_and_si256(v, cyrillic_mask),
+                                  cyrillic_lead),
+                _mm256_and_si256(_mm256_cmpeq_epi8(v, d4),
+                                 _mm256_cmpgt_epi8(after_d4_end, next)));
+            chars = _mm256_sub_epi8(chars, lead);
+            cyrillic = _mm256_sub_epi8(cyrillic, cyr);
+
+            unsigned rare = _mm256_movemask_epi8(_mm256_or_si256(
+                _mm256_cmpeq_epi8(v, e1), _mm256_cmpeq_epi8(v, ea)));
+            for (; rare != 0; rare &= rare - 1) {
+                const auto* q = p + __builtin_ctz(rare);
+                counts.cyrillic += IsCyrillicTail(q, end - q);
+            }
+        }
+        counts.chars += SumBytesAvx2(chars);
+        counts.cyrillic += SumBytesAvx2(cyrillic);
+    }
+    return p;
+}
+
+inline bool HasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+#endif
+
+}  // namespace utf8_detail
+
+enum class Utf8Impl {
+    Scalar,
+    Sse2,
+    Avx2,
+    // The fastest one supported by the CPU
+    Best,
+};
+
+// Adds the code points of [data, data + size) to counts. Sequences cut by the
+// end of the buffer count as code points, but never as Cyrillic ones.
+inline void CountUtf8(const char* data, size_t size, Utf8Counts& counts,
+                      Utf8Impl impl = Utf8Impl::Best) {
+    const auto* p = reinterpret_cast<const unsigned char*>(data);
+    const auto* end = p + size;
+#if defined(__x86_64__)
+    if (impl == Utf8Impl::Best) {
+        impl = utf8_detail::HasAvx2() ? Utf8Impl::Avx2 : Utf8Impl::Sse2;
+    }
+    if (impl == Utf8Impl::Avx2) {
+        p = utf8_detail::CountAvx2(p, end, counts);
+    }
+    if (impl != Utf8Impl::Scalar) {
+        p = utf8_detail::CountSse2(p, end, counts);
+    }
+#else
+    (void)impl;
+#endif
+    utf8_detail::CountScalar(p, end, counts);
+}
+
+namespace utf8_detail {
+
+// Allowed range of the second byte and the length of a sequence by its lead
+// byte (RFC 3629, section 4). Zero length marks bytes which can't start a
+// sequence.
+struct LeadInfo {
+    uint8_t length = 0;
+    uint8_t second_min = 0x80;
+    uint8_t second_max = 0xBF;
+};
+
+constexpr std::array<LeadInfo, 256> kLeadInfo = [] {
+    std::array<LeadInfo, 256> info{};
+    for (int b = 0; b < 256; ++b) {
+        if (b < 0x80) {
+            info[b].length = 1;
+        } else if (b >= 0xC2 && b <= 0xDF) {
+            info[b].length = 2;
+        } else if (b >= 0xE0 && b <= 0xEF) {
+            info[b].length = 3;
+        } else if (b >= 0xF0 && b <= 0xF4) {
+            info[b].length = 4;
+        }
+    }
+    // Overlong forms, surrogates and code points above U+10FFFF
+    info[0xE0].second_min = 0xA0;
+    info[0xED].second_max = 0x9F;
+    info[0xF0].second_min = 0x90;
+    info[0xF4].second_max = 0x8F;
+    return info;
+}();
+
+}  // namespace utf8_detail
+
+// Returns the offset of the first malformed (or truncated) sequence, or size
+// if the whole buffer is valid UTF-8
+inline size_t FindInvalidUtf8(const char* data, size_t size) {
+    const auto* begin = reinterpret_cast<const unsigned char*>(data);
+    const auto* p = begin;
+    const auto* end = begin + size;
+    while (p < end) {
+#if defined(__x86_64__)
+        // ASCII runs are skipped 16 bytes at a time
+        while (end - p >= 16) {
+            const __m128i v =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const unsigned high = _mm_movemask_epi8(v);
+            if (high != 0) {
+                p += __builtin_ctz(high);
+                break;
+            }
+            p += 16;
+        }
+        if (p == end) {
+            break;
+        }
+#endif
+        const auto& info = utf8_detail::kLeadInfo[*p];
+        if (info.length == 0 || end - p < info.length) {
+            return p - begin;
+        }
+        if (info.length > 1 &&
+            (p[1] < info.second_min || p[1] > info.second_max)) {
+            return p - begin;
+        }
+        for (size_t i = 2; i < info.length; ++i) {
+            if (p[i] < 0x80 || p[i] > 0xBF) {
+                return p - begin;
+            }
+        }
+        p += info.length;
+    }
+    return size;
+}
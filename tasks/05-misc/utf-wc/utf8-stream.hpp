@@ -0,0 +1,183 @@
+#pragma once
+
+#include "utf8-count.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace utf8_detail {
+
+inline bool IsContinuation(unsigned char b) {
+    return (b & 0xC0) == 0x80;
+}
+
+// Length of a sequence as announced by its lead byte, malformed leads are
+// taken at their word as well
+inline size_t AnnouncedLength(unsigned char b) {
+    if (b >= 0xF0) {
+        return 4;
+    }
+    if (b >= 0xE0) {
+        return 3;
+    }
+    return b >= 0xC0 ? 2 : 1;
+}
+
+}  // namespace utf8_detail
+
+// Length of the longest prefix of the buffer which doesn't end in the middle
+// of a sequence
+inline size_t CompleteUtf8Prefix(const char* data, size_t size) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    const size_t stop = size > 3 ? size - 3 : 0;
+    for (size_t i = size; i > stop; --i) {
+        if (!utf8_detail::IsContinuation(bytes[i - 1])) {
+            const bool cut =
+                i - 1 + utf8_detail::AnnouncedLength(bytes[i - 1]) > size;
+            return cut ? i - 1 : size;
+        }
+    }
+    return size;
+}
+
+// Counts a stream fed by arbitrary pieces. A sequence cut by the end of a
+// piece is kept until the next one, so for valid input the result doesn't
+// depend on how the stream is split.
+class Utf8Counter {
+  public:
+    explicit Utf8Counter(bool validate = false) : validate_{validate} {
+    }
+
+    void Feed(const char* data, size_t size) {
+        if (carry_size_ > 0) {
+            const size_t length = utf8_detail::AnnouncedLength(
+                static_cast<unsigned char>(carry_[0]));
+            const size_t taken = std::min(length - carry_size_, size);
+            std::memcpy(carry_ + carry_size_, data, taken);
+            carry_size_ += taken;
+            data += taken;
+            size -= taken;
+            if (carry_size_ < length) {
+                return;
+            }
+            Consume(carry_, carry_size_);
+            carry_size_ = 0;
+        }
+
+        const size_t complete = CompleteUtf8Prefix(data, size);
+        Consume(data, complete);
+        carry_size_ = size - complete;
+        std::memcpy(carry_, data + complete, carry_size_);
+    }
+
+    // Counts the rest of the stream, a sequence cut by its end included
+    Utf8Counts Finish() {
+        Consume(carry_, carry_size_);
+        carry_size_ = 0;
+        return counts_;
+    }
+
+    // Offset of the first malformed sequence seen so far, always empty
+    // without validation
+    std::optional<uint64_t> InvalidOffset() const {
+        return invalid_;
+    }
+
+  private:
+    void Consume(const char* data, size_t size) {
+        CountUtf8(data, size, counts_);
+        if (validate_ && !invalid_) {
+            const size_t invalid = FindInvalidUtf8(data, size);
+            if (invalid != size) {
+                invalid_ = offset_ + invalid;
+            }
+        }
+        offset_ += size;
+    }
+
+    const bool validate_;
+    Utf8Counts counts_;
+    uint64_t offset_ = 0;
+    std::optional<uint64_t> invalid_;
+    char carry_[4] = {};
+    size_t carry_size_ = 0;
+};
+
+// Splits the buffer into at most parts ranges, all starting at code point
+// boundaries. Returns the boundaries, the first one is 0 and the last is
+// size.
+inline std::vector<size_t> SplitUtf8(const char* data, size_t size,
+                                     size_t parts) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    std::vector<size_t> bounds = {0};
+    for (size_t i = 1; i < parts; ++i) {
+        size_t pos = std::max(bounds.back(), size / parts * i);
+        while (pos < size && utf8_detail::IsContinuation(bytes[pos])) {
+            ++pos;
+        }
+        bounds.push_back(pos);
+    }
+    bounds.push_back(size);
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+    return bounds;
+}
+
+// Smaller pieces aren't worth a thread
+constexpr size_t kMinBytesPerThread = 1 << 20;
+
+// Counts the buffer with up to threads threads. With non-null invalid, the
+// buffer is validated as well and *invalid is set to the offset of the first
+// malformed sequence, or to size.
+inline Utf8Counts CountUtf8Parallel(const char* data, size_t size,
+                                    unsigned threads,
+                                    size_t* invalid = nullptr) {
+    const size_t parts = std::clamp<size_t>(size / kMinBytesPerThread, 1,
+                                            std::max(1u, threads));
+    const auto bounds = SplitUtf8(data, size, parts);
+    const size_t ranges = bounds.size() - 1;
+
+    std::vector<Utf8Counts> counts(ranges);
+    std::vector<size_t> invalids(ranges, size);
+    auto work = [&](size_t range) {
+        const char* begin = data + bounds[range];
+        const size_t length = bounds[range + 1] - bounds[range];
+        // Counted locally, neighbouring results share cache lines
+        Utf8Counts local;
+        CountUtf8(begin, length, local);
+        counts[range] = local;
+        if (invalid) {
+            const size_t offset = FindInvalidUtf8(begin, length);
+            if (offset != length) {
+                invalids[range] = bounds[range] + offset;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t range = 1; range < ranges; ++range) {
+        workers.emplace_back(work, range);
+    }
+    if (ranges > 0) {
+        work(0);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    Utf8Counts total;
+    for (const auto& range_counts : counts) {
+        total += range_counts;
+    }
+    if (invalid) {
+        *invalid = size;
+        for (auto offset : invalids) {
+            *invalid = std::min(*invalid, offset);
+        }
+    }
+    return total;
+}